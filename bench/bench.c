@@ -0,0 +1,68 @@
+/*
+ * Count allocations; every benchmark is linked with
+ * -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc so that calls to these
+ * functions from the benchmark and from libzebu.a come here first
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#include "bench.h"
+
+size_t bench_allocs;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+	__atomic_fetch_add(&bench_allocs, 1, __ATOMIC_RELAXED);
+	return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size)
+{
+	__atomic_fetch_add(&bench_allocs, 1, __ATOMIC_RELAXED);
+	return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+	__atomic_fetch_add(&bench_allocs, 1, __ATOMIC_RELAXED);
+	return __real_realloc(ptr, size);
+}
+
+/* Writing 5 to clear_refs sets the high-water mark of the resident set size,
+ * VmHWM, to the current size; Linux only */
+void bench_reset_peak_rss(void)
+{
+	FILE *f = fopen("/proc/self/clear_refs", "w");
+
+	if (f == NULL)
+		return;
+	fputs("5", f);
+	fclose(f);
+}
+
+long bench_peak_rss(void)
+{
+	struct rusage ru;
+	char line[128];
+	long kb = -1;
+	FILE *f;
+
+	f = fopen("/proc/self/status", "r");
+	if (f != NULL) {
+		while (fgets(line, sizeof(line), f) != NULL) {
+			if (strncmp(line, "VmHWM:", 6) == 0)
+				kb = strtol(line + 6, NULL, 10);
+		}
+		fclose(f);
+	}
+	if (kb >= 0)
+		return kb;
+	getrusage(RUSAGE_SELF, &ru);
+	return ru.ru_maxrss;
+}
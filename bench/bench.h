@@ -0,0 +1,64 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#ifndef ZEBU_BENCH_H_
+#define ZEBU_BENCH_H_
+
+/*
+ * Helpers shared by all benchmarks
+ *
+ * Every result is printed as a line of tab-separated fields: name, number of
+ * operations, nanoseconds per operation, allocations per operation and peak
+ * resident set size of the process in kilobytes while the benchmark ran,
+ * counting the memory it already held when it started. The peak is reset by
+ * bench_start() through /proc/self/clear_refs; where that isn't possible, it
+ * is the peak of the whole process so far.
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+/* Number of calls to malloc(), calloc() and realloc() since the start; see
+ * bench.c */
+extern size_t bench_allocs;
+
+/* Reset the peak resident set size of the process to the current one, and
+ * get it in kilobytes; see bench.c */
+void bench_reset_peak_rss(void);
+long bench_peak_rss(void);
+
+/* State at the start of a measurement */
+struct bench {
+	double time;
+	size_t allocs;
+};
+
+/* Current time in nanoseconds */
+static inline double bench_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Start a measurement */
+static inline void bench_start(struct bench *b)
+{
+	bench_reset_peak_rss();
+	b->allocs = __atomic_load_n(&bench_allocs, __ATOMIC_RELAXED);
+	b->time = bench_now();
+}
+
+/* Print the result of a benchmark that did ``ops`` operations since ``b`` was
+ * started */
+static inline void bench_report(const char *name, size_t ops,
+		const struct bench *b)
+{
+	double elapsed = bench_now() - b->time;
+	size_t allocs = __atomic_load_n(&bench_allocs, __ATOMIC_RELAXED) - b->allocs;
+
+	printf("%s\t%zu\t%.1f\t%.3f\t%ld\n", name, ops, elapsed / ops,
+			(double)allocs / ops, bench_peak_rss());
+	fflush(stdout);
+}
+
+#endif       // ZEBU_BENCH_H_
@@ -0,0 +1,110 @@
+/*
+ * Indexed access to children, with and without parent links, and on frozen
+ * trees, for nodes with few and with many children
+ */
+
+#include <stdio.h>
+
+#include "../src/zebu.h"
+#include "bench.h"
+
+#define COUNT 1000000
+#define ROUNDS 10
+
+static const char *TOK_EXPR = "expr";
+
+/* Build a tree of COUNT nodes where every node has ``fanout`` children */
+static struct zz_node *build(struct zz_tree *tree, struct zz_node **nodes,
+		size_t fanout)
+{
+	size_t i;
+
+	for (i = 0; i < COUNT; ++i) {
+		nodes[i] = zz_node(tree, TOK_EXPR, zz_int(i));
+		if (i > 0)
+			zz_append_child(nodes[(i - 1) / fanout], nodes[i]);
+	}
+	return nodes[0];
+}
+
+static void run(const char *prefix, unsigned int flags, size_t fanout)
+{
+	struct zz_tree tree;
+	struct zz_frozen f;
+	const struct zz_frozen_node *fn;
+	struct zz_node **nodes, *c;
+	struct bench start;
+	char name[64];
+	size_t i, j, k, count, parents, ops;
+	long total;
+
+	nodes = malloc(COUNT * sizeof(*nodes));
+	zz_tree_init_flags(&tree, sizeof(struct zz_node), flags);
+	build(&tree, nodes, fanout);
+	parents = (COUNT - 2) / fanout + 1;
+
+	/* Every child of every node, by index */
+	bench_start(&start);
+	total = ops = 0;
+	for (j = 0; j < ROUNDS; ++j) {
+		for (i = 0; i < parents; ++i) {
+			count = zz_child_count(nodes[i]);
+			for (k = 0; k < count; ++k) {
+				c = zz_child(nodes[i], k);
+				total += zz_get_int(c);
+				++ops;
+			}
+		}
+	}
+	snprintf(name, sizeof(name), "%s_child_all", prefix);
+	bench_report(name, ops, &start);
+	if (total == 0)
+		abort();
+
+	/* The third child of every node that has one */
+	bench_start(&start);
+	total = ops = 0;
+	for (j = 0; j < ROUNDS; ++j) {
+		for (i = 0; i < parents; ++i) {
+			c = zz_child(nodes[i], 2);
+			if (c != NULL)
+				total += zz_get_int(c);
+			++ops;
+		}
+	}
+	snprintf(name, sizeof(name), "%s_child_2", prefix);
+	bench_report(name, ops, &start);
+	if (total == 0)
+		abort();
+
+	if (flags == 0) {
+		zz_tree_freeze(nodes[0], &f);
+		bench_start(&start);
+		total = ops = 0;
+		for (j = 0; j < ROUNDS; ++j) {
+			for (i = 0; i < parents; ++i) {
+				fn = zz_frozen_child(&f, zz_frozen_at(&f, i), 2);
+				if (fn != NULL)
+					total += fn->data.data.int_val;
+				++ops;
+			}
+		}
+		snprintf(name, sizeof(name), "%s_frozen_child_2", prefix);
+		bench_report(name, ops, &start);
+		if (total == 0)
+			abort();
+		zz_frozen_destroy(&f);
+	}
+
+	zz_tree_destroy(&tree);
+	free(nodes);
+}
+
+int main(int argc, char *argv[])
+{
+	run("child_fanout4", 0, 4);
+	run("child_fanout4_parents", ZZ_TREE_PARENTS, 4);
+	run("child_fanout1000", 0, 1000);
+	run("child_fanout1000_parents", ZZ_TREE_PARENTS, 1000);
+	exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,81 @@
+/*
+ * Compare the default node layout with the compact one on balanced trees
+ */
+
+#include <stdio.h>
+
+#include "../src/zebu.h"
+#include "bench.h"
+
+#define COUNT 1000000
+#define FANOUT 4
+#define ROUNDS 10
+
+static const char *TOK_EXPR = "expr";
+
+static long sum(struct zz_node *node)
+{
+	struct zz_node *iter;
+	long s = zz_get_int(node);
+	zz_foreach_child(iter, node)
+		s += sum(iter);
+	return s;
+}
+
+static void run(const char *prefix, unsigned int flags)
+{
+	struct zz_tree tree;
+	struct zz_node **nodes, *root;
+	struct bench start;
+	char name[64];
+	long total;
+	size_t i;
+	FILE *f;
+
+	nodes = malloc(COUNT * sizeof(*nodes));
+	zz_tree_init_flags(&tree, sizeof(struct zz_node), flags);
+
+	bench_start(&start);
+	for (i = 0; i < COUNT; ++i) {
+		nodes[i] = zz_node(&tree, TOK_EXPR, zz_int(i));
+		if (i > 0)
+			zz_append_child(nodes[(i - 1) / FANOUT], nodes[i]);
+	}
+	root = nodes[0];
+	snprintf(name, sizeof(name), "%s_build", prefix);
+	bench_report(name, COUNT, &start);
+
+	bench_start(&start);
+	total = 0;
+	for (i = 0; i < ROUNDS; ++i)
+		total += sum(root);
+	snprintf(name, sizeof(name), "%s_traverse", prefix);
+	bench_report(name, COUNT * ROUNDS, &start);
+	if (total != (long)ROUNDS * COUNT * (COUNT - 1) / 2)
+		abort();
+
+	f = fopen("/dev/null", "w");
+	bench_start(&start);
+	zz_print(root, f);
+	snprintf(name, sizeof(name), "%s_print", prefix);
+	bench_report(name, COUNT, &start);
+	fclose(f);
+
+	bench_start(&start);
+	zz_destroy(zz_copy_recursive(&tree, root));
+	snprintf(name, sizeof(name), "%s_copy_destroy", prefix);
+	bench_report(name, COUNT, &start);
+
+	bench_start(&start);
+	zz_tree_destroy(&tree);
+	snprintf(name, sizeof(name), "%s_tree_destroy", prefix);
+	bench_report(name, COUNT, &start);
+	free(nodes);
+}
+
+int main(int argc, char *argv[])
+{
+	run("layout_default", 0);
+	run("layout_compact", ZZ_TREE_COMPACT);
+	exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,52 @@
+/*
+ * Walk degenerate trees, deep enough to overflow the stack if done recursively
+ */
+
+#include <stdio.h>
+
+#include "../src/zebu.h"
+#include "bench.h"
+
+#define DEPTH 10000000
+
+static const char *TOK_STMT = "stmt";
+
+int main(int argc, char *argv[])
+{
+	struct zz_tree tree;
+	struct zz_node *root, *copy, *n, *c;
+	struct bench start;
+	FILE *f;
+	size_t i;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+
+	bench_start(&start);
+	root = n = zz_node(&tree, TOK_STMT, zz_null);
+	for (i = 1; i < DEPTH; ++i) {
+		c = zz_node(&tree, TOK_STMT, zz_int(i));
+		zz_append_child(n, c);
+		n = c;
+	}
+	bench_report("deep_build", DEPTH, &start);
+
+	bench_start(&start);
+	copy = zz_copy_recursive(&tree, root);
+	bench_report("deep_copy_recursive", DEPTH, &start);
+
+	f = fopen("/dev/null", "w");
+	bench_start(&start);
+	zz_print(copy, f);
+	bench_report("deep_print", DEPTH, &start);
+	fclose(f);
+
+	bench_start(&start);
+	zz_destroy(copy);
+	bench_report("deep_destroy", DEPTH, &start);
+
+	bench_start(&start);
+	zz_tree_destroy(&tree);
+	bench_report("deep_tree_destroy", DEPTH, &start);
+
+	exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,101 @@
+/*
+ * Compare the hash table dictionary against the AA tree it replaced
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "../src/dict.h"
+#include "aa_dict.h"
+#include "bench.h"
+
+#define COUNT 1000000
+
+static char (*keys)[16];
+
+static void hash_dict(void)
+{
+	struct zz_dict *dict = NULL;
+	const char **vals;
+	const char *s;
+	struct bench start;
+	size_t i;
+
+	vals = calloc(COUNT, sizeof(*vals));
+
+	bench_start(&start);
+	for (i = 0; i < COUNT; ++i)
+		dict = zz_dict_insert(dict, keys[i], &vals[i]);
+	bench_report("hash_dict_insert", COUNT, &start);
+
+	bench_start(&start);
+	for (i = 0; i < COUNT; ++i)
+		dict = zz_dict_insert(dict, keys[i], &s);
+	bench_report("hash_dict_insert_existing", COUNT, &start);
+
+	bench_start(&start);
+	for (i = 0; i < COUNT; ++i)
+		zz_dict_lookup(dict, keys[i], &s);
+	bench_report("hash_dict_lookup", COUNT, &start);
+
+	bench_start(&start);
+	for (i = 0; i < COUNT; ++i)
+		dict = zz_dict_delete(dict, keys[i]);
+	bench_report("hash_dict_delete", COUNT, &start);
+
+	bench_start(&start);
+	for (i = 0; i < COUNT; ++i)
+		dict = zz_dict_unref(dict, vals[i]);
+	bench_report("hash_dict_unref", COUNT, &start);
+
+	assert(dict == NULL);
+	free(vals);
+}
+
+static void aa_dict(void)
+{
+	struct aa_dict *dict = NULL;
+	const char *s;
+	struct bench start;
+	size_t i;
+
+	bench_start(&start);
+	for (i = 0; i < COUNT; ++i)
+		dict = aa_dict_insert(dict, keys[i], &s);
+	bench_report("aa_dict_insert", COUNT, &start);
+
+	bench_start(&start);
+	for (i = 0; i < COUNT; ++i)
+		dict = aa_dict_insert(dict, keys[i], &s);
+	bench_report("aa_dict_insert_existing", COUNT, &start);
+
+	bench_start(&start);
+	for (i = 0; i < COUNT; ++i)
+		aa_dict_lookup(dict, keys[i], &s);
+	bench_report("aa_dict_lookup", COUNT, &start);
+
+	bench_start(&start);
+	for (i = 0; i < COUNT; ++i)
+		dict = aa_dict_delete(dict, keys[i]);
+	bench_report("aa_dict_delete", COUNT, &start);
+
+	bench_start(&start);
+	for (i = 0; i < COUNT; ++i)
+		dict = aa_dict_delete(dict, keys[i]);
+	bench_report("aa_dict_delete_last", COUNT, &start);
+
+	assert(dict == NULL);
+}
+
+int main(int argc, char *argv[])
+{
+	size_t i;
+
+	keys = calloc(COUNT, sizeof(*keys));
+	for (i = 0; i < COUNT; ++i)
+		snprintf(keys[i], sizeof(*keys), "id_%zu", i * 7919 % COUNT);
+	hash_dict();
+	aa_dict();
+	free(keys);
+	exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,98 @@
+/*
+ * Diff trees of a million nodes that differ in a few places
+ */
+
+#include <stdio.h>
+
+#include "../src/zebu.h"
+#include "bench.h"
+
+#define COUNT 1000000
+#define FANOUT 4
+#define EDITS 10
+
+static const char *TOK_NUM = "num";
+static const char *TOK_NEW = "new";
+
+static struct zz_node *build(struct zz_tree *tree, struct zz_node **nodes)
+{
+	size_t i;
+
+	for (i = 0; i < COUNT; ++i) {
+		nodes[i] = zz_node(tree, TOK_NUM, zz_int(i % 1000));
+		if (i > 0)
+			zz_append_child(nodes[(i - 1) / FANOUT], nodes[i]);
+	}
+	return nodes[0];
+}
+
+/* Update, insert and delete at places spread over the tree */
+static void edit(struct zz_node **nodes, size_t round)
+{
+	struct zz_node *n;
+	size_t i, k;
+
+	for (i = 0; i < EDITS; ++i) {
+		k = (round * EDITS + i) * 7919 % (COUNT / FANOUT) + 1;
+		n = nodes[k];
+		switch (i % 3) {
+		case 0:
+			zz_set_int(n, -1);
+			break;
+		case 1:
+			zz_append_child(n, zz_node(n->tree, TOK_NEW, zz_null));
+			break;
+		case 2:
+			n = zz_last_child(n);
+			if (n != NULL && n->token == TOK_NUM)
+				zz_unlink_child(n);
+			break;
+		}
+	}
+}
+
+static void run(const char *prefix, unsigned int flags)
+{
+	struct zz_tree tree;
+	struct zz_node **a, **b;
+	struct zz_diff d;
+	struct bench start;
+	char name[64];
+	size_t i, edits = 0;
+
+	a = malloc(COUNT * sizeof(*a));
+	b = malloc(COUNT * sizeof(*b));
+	zz_tree_init_flags(&tree, sizeof(struct zz_node), flags);
+	build(&tree, a);
+	build(&tree, b);
+	edit(b, 0);
+	zz_diff_init(&d);
+
+	bench_start(&start);
+	edits += zz_diff(&d, a[0], b[0]);
+	snprintf(name, sizeof(name), "%s_diff_first", prefix);
+	bench_report(name, COUNT, &start);
+
+	/* Again after more edits, as after each parse of a file */
+	bench_start(&start);
+	for (i = 1; i <= 10; ++i) {
+		edit(b, i);
+		edits += zz_diff(&d, a[0], b[0]);
+	}
+	snprintf(name, sizeof(name), "%s_diff_again", prefix);
+	bench_report(name, 10, &start);
+
+	if (edits == 0)
+		abort();
+	zz_diff_destroy(&d);
+	zz_tree_destroy(&tree);
+	free(a);
+	free(b);
+}
+
+int main(int argc, char *argv[])
+{
+	run("uncached", ZZ_TREE_PARENTS);
+	run("cached", ZZ_TREE_PARENTS | ZZ_TREE_HASHES);
+	exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,120 @@
+/*
+ * Compare walks of a tree with walks of its frozen copy, on balanced trees
+ * whose nodes are allocated in order and in random order
+ */
+
+#include <stdio.h>
+
+#include "../src/zebu.h"
+#include "bench.h"
+
+#define COUNT 1000000
+#define FANOUT 4
+#define ROUNDS 10
+
+static const char *TOK_EXPR = "expr";
+
+static long sum(struct zz_node *node)
+{
+	struct zz_node *iter;
+	long s = zz_get_int(node);
+	zz_foreach_child(iter, node)
+		s += sum(iter);
+	return s;
+}
+
+static long frozen_sum(const struct zz_frozen *f, const struct zz_frozen_node *node)
+{
+	const struct zz_frozen_node *iter;
+	long s = node->data.data.int_val;
+	zz_frozen_foreach_child(iter, f, node)
+		s += frozen_sum(f, iter);
+	return s;
+}
+
+static long frozen_scan(const struct zz_frozen *f)
+{
+	const struct zz_frozen_node *iter;
+	long s = 0;
+	zz_frozen_foreach(iter, f, zz_frozen_root(f))
+		s += iter->data.data.int_val;
+	return s;
+}
+
+static void check(long total)
+{
+	if (total != (long)ROUNDS * COUNT * (COUNT - 1) / 2)
+		abort();
+}
+
+static void run(const char *prefix, int shuffle)
+{
+	struct zz_tree tree;
+	struct zz_frozen f;
+	struct zz_node **nodes, *tmp;
+	struct bench start;
+	char name[64];
+	long total;
+	size_t i, j;
+
+	/* Nodes are numbered level by level, but allocated in the order they
+	 * end up in ``nodes`` */
+	nodes = malloc(COUNT * sizeof(*nodes));
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	for (i = 0; i < COUNT; ++i)
+		nodes[i] = zz_node(&tree, TOK_EXPR, zz_null);
+	if (shuffle) {
+		srand(1);
+		for (i = COUNT - 1; i > 0; --i) {
+			j = rand() % (i + 1);
+			tmp = nodes[i];
+			nodes[i] = nodes[j];
+			nodes[j] = tmp;
+		}
+	}
+	for (i = 0; i < COUNT; ++i) {
+		nodes[i]->data = zz_int(i);
+		if (i > 0)
+			zz_append_child(nodes[(i - 1) / FANOUT], nodes[i]);
+	}
+
+	bench_start(&start);
+	total = 0;
+	for (i = 0; i < ROUNDS; ++i)
+		total += sum(nodes[0]);
+	snprintf(name, sizeof(name), "%s_tree_traverse", prefix);
+	bench_report(name, COUNT * ROUNDS, &start);
+	check(total);
+
+	bench_start(&start);
+	zz_tree_freeze(nodes[0], &f);
+	snprintf(name, sizeof(name), "%s_freeze", prefix);
+	bench_report(name, COUNT, &start);
+
+	bench_start(&start);
+	total = 0;
+	for (i = 0; i < ROUNDS; ++i)
+		total += frozen_sum(&f, zz_frozen_root(&f));
+	snprintf(name, sizeof(name), "%s_frozen_traverse", prefix);
+	bench_report(name, COUNT * ROUNDS, &start);
+	check(total);
+
+	bench_start(&start);
+	total = 0;
+	for (i = 0; i < ROUNDS; ++i)
+		total += frozen_scan(&f);
+	snprintf(name, sizeof(name), "%s_frozen_scan", prefix);
+	bench_report(name, COUNT * ROUNDS, &start);
+	check(total);
+
+	zz_frozen_destroy(&f);
+	zz_tree_destroy(&tree);
+	free(nodes);
+}
+
+int main(int argc, char *argv[])
+{
+	run("freeze_ordered", 0);
+	run("freeze_shuffled", 1);
+	exit(EXIT_SUCCESS);
+}
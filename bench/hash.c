@@ -0,0 +1,80 @@
+/*
+ * Hash and compare balanced trees, with and without cached hashes
+ */
+
+#include <stdio.h>
+
+#include "../src/zebu.h"
+#include "bench.h"
+
+#define COUNT 1000000
+#define FANOUT 4
+#define REPEAT 100
+
+static const char *TOK_NUM = "num";
+
+static struct zz_node *build(struct zz_tree *tree, struct zz_node **nodes)
+{
+	size_t i;
+
+	for (i = 0; i < COUNT; ++i) {
+		nodes[i] = zz_node(tree, TOK_NUM, zz_int(i % 1000));
+		if (i > 0)
+			zz_append_child(nodes[(i - 1) / FANOUT], nodes[i]);
+	}
+	return nodes[0];
+}
+
+static void run(const char *prefix, unsigned int flags)
+{
+	struct zz_tree tree;
+	struct zz_node **nodes, *a, *b;
+	struct bench start;
+	char name[64];
+	size_t i, hash = 0;
+
+	nodes = malloc(COUNT * sizeof(*nodes));
+	zz_tree_init_flags(&tree, sizeof(struct zz_node), flags);
+	b = build(&tree, nodes);
+	a = build(&tree, nodes);
+
+	bench_start(&start);
+	hash = zz_hash(a);
+	snprintf(name, sizeof(name), "%s_hash_first", prefix);
+	bench_report(name, COUNT, &start);
+
+	bench_start(&start);
+	for (i = 0; i < REPEAT; ++i)
+		hash += zz_hash(a);
+	snprintf(name, sizeof(name), "%s_hash_again", prefix);
+	bench_report(name, REPEAT, &start);
+
+	/* Change a leaf and hash again */
+	bench_start(&start);
+	for (i = 0; i < REPEAT; ++i) {
+		zz_set_int(nodes[COUNT - 1 - i * 7919 % (COUNT / 2)], i);
+		hash += zz_hash(a);
+	}
+	snprintf(name, sizeof(name), "%s_hash_changed", prefix);
+	bench_report(name, REPEAT, &start);
+
+	/* Unequal trees with a known hash are told apart at once */
+	hash += zz_hash(b);
+	bench_start(&start);
+	for (i = 0; i < REPEAT; ++i)
+		hash += zz_equal(a, b);
+	snprintf(name, sizeof(name), "%s_equal_different", prefix);
+	bench_report(name, REPEAT, &start);
+
+	if (hash == 0)
+		abort();
+	zz_tree_destroy(&tree);
+	free(nodes);
+}
+
+int main(int argc, char *argv[])
+{
+	run("uncached", ZZ_TREE_PARENTS);
+	run("cached", ZZ_TREE_PARENTS | ZZ_TREE_HASHES);
+	exit(EXIT_SUCCESS);
+}
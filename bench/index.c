@@ -0,0 +1,92 @@
+/*
+ * Find all nodes of a token by walking the tree and through the token index
+ */
+
+#include <stdio.h>
+
+#include "../src/zebu.h"
+#include "bench.h"
+
+#define COUNT 1000000
+#define FANOUT 4
+#define TOKENS 16
+#define ROUNDS 10
+
+static size_t walk(struct zz_node *n, const char *token)
+{
+	struct zz_node *iter;
+	size_t count = n->token == token;
+	zz_foreach_child(iter, n)
+		count += walk(iter, token);
+	return count;
+}
+
+static size_t lookup(struct zz_tree *tree, const char *token)
+{
+	struct zz_node *n;
+	size_t count = 0;
+	zz_tree_foreach_of(n, tree, token)
+		++count;
+	return count;
+}
+
+int main(int argc, char *argv[])
+{
+	struct zz_tokens t;
+	struct zz_tree plain, indexed;
+	struct zz_node **nodes, *root;
+	const char *tokens[TOKENS];
+	struct bench start;
+	size_t i, found, expected;
+	char name[16];
+
+	zz_tokens_init(&t);
+	for (i = 0; i < TOKENS; ++i) {
+		snprintf(name, sizeof(name), "tok%zu", i);
+		tokens[i] = zz_tokens_add(&t, name);
+	}
+	nodes = malloc(COUNT * sizeof(*nodes));
+
+	zz_tree_init(&plain, sizeof(struct zz_node));
+	bench_start(&start);
+	for (i = 0; i < COUNT; ++i) {
+		nodes[i] = zz_node(&plain, tokens[i * 7 % TOKENS], zz_null);
+		if (i > 0)
+			zz_append_child(nodes[(i - 1) / FANOUT], nodes[i]);
+	}
+	bench_report("index_plain_build", COUNT, &start);
+	root = nodes[0];
+
+	zz_tree_init_flags(&indexed, sizeof(struct zz_node), ZZ_TREE_TOKEN_INDEX);
+	zz_tree_set_tokens(&indexed, &t);
+	bench_start(&start);
+	for (i = 0; i < COUNT; ++i) {
+		nodes[i] = zz_node(&indexed, tokens[i * 7 % TOKENS], zz_null);
+		if (i > 0)
+			zz_append_child(nodes[(i - 1) / FANOUT], nodes[i]);
+	}
+	bench_report("index_indexed_build", COUNT, &start);
+
+	expected = ROUNDS * COUNT / TOKENS;
+	bench_start(&start);
+	found = 0;
+	for (i = 0; i < ROUNDS; ++i)
+		found += walk(root, tokens[3]);
+	bench_report("index_walk_query", ROUNDS, &start);
+	if (found != expected)
+		abort();
+
+	bench_start(&start);
+	found = 0;
+	for (i = 0; i < ROUNDS; ++i)
+		found += lookup(&indexed, tokens[3]);
+	bench_report("index_lookup_query", ROUNDS, &start);
+	if (found != expected)
+		abort();
+
+	zz_tree_destroy(&plain);
+	zz_tree_destroy(&indexed);
+	zz_tokens_destroy(&t);
+	free(nodes);
+	exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,54 @@
+/*
+ * Build and destroy trees of short identifiers, interned and stored inline
+ */
+
+#include <stdio.h>
+
+#include "../src/zebu.h"
+#include "bench.h"
+
+#define COUNT 1000000
+#define FANOUT 4
+
+static const char *TOK_IDENT = "ident";
+
+/* Build a balanced tree of identifiers, ``distinct`` of them different */
+static void run(const char *prefix, unsigned int flags, size_t distinct)
+{
+	struct zz_tree tree;
+	struct zz_node **nodes;
+	struct bench start;
+	char name[64], buf[16];
+	size_t i;
+	int len;
+
+	nodes = malloc(COUNT * sizeof(*nodes));
+	zz_tree_init_flags(&tree, sizeof(struct zz_node), flags);
+	bench_start(&start);
+	for (i = 0; i < COUNT; ++i) {
+		len = snprintf(buf, sizeof(buf), "v%zu", i * 7919 % distinct);
+		nodes[i] = zz_node(&tree, TOK_IDENT,
+				zz_tree_string_n(&tree, buf, len));
+		if (i > 0)
+			zz_append_child(nodes[(i - 1) / FANOUT], nodes[i]);
+	}
+	snprintf(name, sizeof(name), "%s_build", prefix);
+	bench_report(name, COUNT, &start);
+
+	bench_start(&start);
+	zz_tree_destroy(&tree);
+	snprintf(name, sizeof(name), "%s_destroy", prefix);
+	bench_report(name, COUNT, &start);
+	free(nodes);
+}
+
+int main(int argc, char *argv[])
+{
+	/* Inline first, so that its peak RSS doesn't count memory that interning
+	 * leaves resident */
+	run("inline_unique", ZZ_TREE_INLINE_STRINGS, COUNT);
+	run("interned_unique", 0, COUNT);
+	run("inline_repeated", ZZ_TREE_INLINE_STRINGS, 10000);
+	run("interned_repeated", 0, 10000);
+	exit(EXIT_SUCCESS);
+}
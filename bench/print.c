@@ -0,0 +1,103 @@
+/*
+ * Compare zz_print() with printing every piece with its own fprintf()
+ */
+
+#include <stdio.h>
+
+#include "../src/zebu.h"
+#include "bench.h"
+
+#define COUNT 1000000
+
+static const char *TOK_EXPR = "expr";
+static const char *TOK_NUM = "num";
+static const char *TOK_STR = "str";
+
+/* zz_print() as it was before it buffered its output */
+static void fprintf_print(struct zz_node *node, FILE *f)
+{
+	struct zz_node *iter;
+
+	fprintf(f, "[%s", node->token);
+	switch (node->data.type) {
+	case ZZ_NULL:
+		break;
+	case ZZ_INT:
+		fprintf(f, " %d", node->data.data.int_val);
+		break;
+	case ZZ_UINT:
+		fprintf(f, " %u", node->data.data.uint_val);
+		break;
+	case ZZ_DOUBLE:
+		fprintf(f, " %f", node->data.data.double_val);
+		break;
+	case ZZ_STRING:
+		fprintf(f, " \"%s\"", node->data.data.string_val);
+		break;
+	case ZZ_POINTER:
+		fprintf(f, " %p", node->data.data.pointer_val);
+		break;
+	}
+	zz_foreach_child(iter, node) {
+		fprintf(f, " ");
+		fprintf_print(iter, f);
+	}
+	fprintf(f, "]");
+}
+
+/* Expressions with three leaves each */
+static struct zz_node *build(struct zz_tree *tree)
+{
+	struct zz_node *root, *n;
+	size_t i;
+
+	root = zz_node(tree, TOK_EXPR, zz_null);
+	for (i = 0; i < COUNT / 4; ++i) {
+		n = zz_node(tree, TOK_EXPR, zz_null);
+		zz_append_child(n, zz_node(tree, TOK_NUM, zz_int(i)));
+		zz_append_child(n, zz_node(tree, TOK_NUM, zz_double(i * 0.25)));
+		zz_append_child(n, zz_node(tree, TOK_STR, zz_string("identifier")));
+		zz_append_child(root, n);
+	}
+	return root;
+}
+
+int main(int argc, char *argv[])
+{
+	struct zz_tree tree;
+	struct zz_node *root;
+	struct bench start;
+	size_t size;
+	char *str;
+	FILE *f;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	root = build(&tree);
+
+	f = fopen("/dev/null", "w");
+	bench_start(&start);
+	fprintf_print(root, f);
+	bench_report("print_fprintf", COUNT, &start);
+
+	bench_start(&start);
+	zz_print(root, f);
+	bench_report("print_buffered", COUNT, &start);
+
+	setvbuf(f, NULL, _IONBF, 0);
+	bench_start(&start);
+	fprintf_print(root, f);
+	bench_report("print_fprintf_unbuffered", COUNT, &start);
+
+	bench_start(&start);
+	zz_print(root, f);
+	bench_report("print_buffered_unbuffered", COUNT, &start);
+	fclose(f);
+
+	bench_start(&start);
+	str = zz_print_to_buffer(root, NULL, &size);
+	bench_report("print_to_buffer", COUNT, &start);
+	free(str);
+
+	zz_tree_destroy(&tree);
+	exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,90 @@
+/*
+ * Expand a large macro body at many call sites, copying it into each in a
+ * tree that doesn't share nodes, and attaching it to each by reference in one
+ * that does
+ */
+
+#include <stdio.h>
+
+#include "../src/zebu.h"
+#include "bench.h"
+
+#define BODY 1000
+#define SITES 10000
+
+static const char *TOK_FILE = "file";
+static const char *TOK_EXPAND = "expand";
+static const char *TOK_BODY = "body";
+static const char *TOK_STMT = "stmt";
+
+static struct zz_node *body(struct zz_tree *tree)
+{
+	struct zz_node *n;
+	int i;
+
+	n = zz_node(tree, TOK_BODY, zz_null);
+	for (i = 0; i < BODY; ++i)
+		zz_append_child(n, zz_node(tree, TOK_STMT, zz_int(i)));
+	return n;
+}
+
+static void copies(void)
+{
+	struct zz_tree tree;
+	struct bench start;
+	struct zz_node *file, *b, *n;
+	size_t i;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	b = body(&tree);
+	bench_start(&start);
+	file = zz_node(&tree, TOK_FILE, zz_null);
+	for (i = 0; i < SITES; ++i) {
+		n = zz_node(&tree, TOK_EXPAND, zz_int(i));
+		zz_append_child(n, zz_copy_recursive(&tree, b));
+		zz_append_child(file, n);
+	}
+	bench_report("ref_copy", SITES, &start);
+	bench_start(&start);
+	zz_unref(file);
+	bench_report("ref_copy_unref", SITES, &start);
+	zz_tree_destroy(&tree);
+}
+
+static void refs(void)
+{
+	struct zz_tree tree, source;
+	struct bench start;
+	struct zz_node **sites, *file, *b;
+	size_t i;
+
+	zz_tree_init(&source, sizeof(struct zz_node));
+	zz_tree_init_flags(&tree, sizeof(struct zz_shared_node), ZZ_TREE_SHARED);
+	b = zz_copy_recursive(&tree, body(&source));
+	zz_tree_destroy(&source);
+	sites = malloc(SITES * sizeof(*sites));
+	bench_start(&start);
+	for (i = 0; i < SITES; ++i)
+		sites[i] = zz_node_shared(&tree, TOK_EXPAND, zz_int(i), &b, 1);
+	file = zz_node_shared(&tree, TOK_FILE, zz_null, sites, SITES);
+	bench_report("ref_shared", SITES, &start);
+	for (i = 0; i < SITES; ++i)
+		zz_unref(sites[i]);
+	free(sites);
+	zz_unref(b);
+	bench_start(&start);
+	zz_unref(file);
+	bench_report("ref_shared_unref", SITES, &start);
+	if (tree.node_count != 0)
+		abort();
+	zz_tree_destroy(&tree);
+}
+
+int main(int argc, char *argv[])
+{
+	/* Shared first, so that its peak RSS doesn't count memory that copies
+	 * leave resident */
+	refs();
+	copies();
+	exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,58 @@
+/*
+ * Parse the same input over and over, as a language server does on every
+ * keystroke: a new tree every time, or the same tree reset
+ */
+
+#include <stdio.h>
+
+#include "../src/zebu.h"
+#include "bench.h"
+
+#define NODES 100000
+#define ROUNDS 50
+
+static const char *TOK_EXPR = "expr";
+static const char *TOK_IDENT = "ident";
+
+static void parse(struct zz_tree *tree)
+{
+	struct zz_node *root, *n;
+	char buf[32];
+	size_t i;
+
+	root = zz_node(tree, TOK_EXPR, zz_null);
+	for (i = 0; i < NODES / 2; ++i) {
+		n = zz_node(tree, TOK_EXPR, zz_int(i));
+		snprintf(buf, sizeof(buf), "ident_%zu", i % 1000);
+		zz_append_child(n, zz_node(tree, TOK_IDENT,
+					zz_tree_string(tree, buf)));
+		zz_append_child(root, n);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	struct zz_tree tree;
+	struct bench start;
+	size_t i;
+
+	bench_start(&start);
+	for (i = 0; i < ROUNDS; ++i) {
+		zz_tree_init_flags(&tree, sizeof(struct zz_node),
+				ZZ_TREE_STRING_POOL);
+		parse(&tree);
+		zz_tree_destroy(&tree);
+	}
+	bench_report("reparse_new_tree", NODES * ROUNDS, &start);
+
+	zz_tree_init_flags(&tree, sizeof(struct zz_node), ZZ_TREE_STRING_POOL);
+	bench_start(&start);
+	for (i = 0; i < ROUNDS; ++i) {
+		parse(&tree);
+		zz_tree_reset(&tree);
+	}
+	bench_report("reparse_reset", NODES * ROUNDS, &start);
+	zz_tree_destroy(&tree);
+
+	exit(EXIT_SUCCESS);
+}
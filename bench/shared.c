@@ -0,0 +1,115 @@
+/*
+ * Build functions that repeat the same types and arguments, in a tree that
+ * shares equal subtrees and in one that doesn't
+ */
+
+#include <stdio.h>
+
+#include "../src/zebu.h"
+#include "bench.h"
+
+#define COUNT 100000
+
+static const char *TOK_FUNC = "func";
+static const char *TOK_TYPE = "type";
+static const char *TOK_IDENT = "ident";
+static const char *TOK_ARGLIST = "arglist";
+static const char *TOK_ARG = "arg";
+static const char *TOK_POINTER = "pointer";
+
+/* The function of tests/build.c, named ``name``; 12 nodes */
+static struct zz_node *build(struct zz_tree *tree, const char *name)
+{
+	struct zz_node *func, *args, *arg, *p;
+
+	func = zz_node(tree, TOK_FUNC, zz_null);
+	zz_append_child(func, zz_node(tree, TOK_TYPE, zz_tree_string(tree, "int")));
+	zz_append_child(func, zz_node(tree, TOK_IDENT, zz_tree_string(tree, name)));
+	args = zz_node(tree, TOK_ARGLIST, zz_null);
+	zz_append_child(func, args);
+	arg = zz_node(tree, TOK_ARG, zz_null);
+	zz_append_child(args, arg);
+	zz_append_child(arg, zz_node(tree, TOK_TYPE, zz_tree_string(tree, "int")));
+	zz_append_child(arg, zz_node(tree, TOK_IDENT, zz_tree_string(tree, "argc")));
+	arg = zz_node(tree, TOK_ARG, zz_null);
+	zz_append_child(args, arg);
+	p = zz_node(tree, TOK_POINTER, zz_null);
+	zz_append_child(arg, p);
+	zz_append_child(p, zz_node(tree, TOK_POINTER, zz_null));
+	zz_append_child(zz_first_child(p),
+			zz_node(tree, TOK_TYPE, zz_tree_string(tree, "char")));
+	zz_append_child(arg, zz_node(tree, TOK_IDENT, zz_tree_string(tree, "argv")));
+	return func;
+}
+
+/* Same function, built from the leaves up */
+static struct zz_node *build_shared(struct zz_tree *tree, const char *name)
+{
+	struct zz_node *c[3], *arg[2], *args, *p;
+
+	c[0] = zz_node(tree, TOK_TYPE, zz_tree_string(tree, "int"));
+	c[1] = zz_node(tree, TOK_IDENT, zz_tree_string(tree, "argc"));
+	arg[0] = zz_node_shared(tree, TOK_ARG, zz_null, c, 2);
+	p = zz_node(tree, TOK_TYPE, zz_tree_string(tree, "char"));
+	p = zz_node_shared(tree, TOK_POINTER, zz_null, &p, 1);
+	c[0] = zz_node_shared(tree, TOK_POINTER, zz_null, &p, 1);
+	c[1] = zz_node(tree, TOK_IDENT, zz_tree_string(tree, "argv"));
+	arg[1] = zz_node_shared(tree, TOK_ARG, zz_null, c, 2);
+	args = zz_node_shared(tree, TOK_ARGLIST, zz_null, arg, 2);
+	c[0] = zz_node(tree, TOK_TYPE, zz_tree_string(tree, "int"));
+	c[1] = zz_node(tree, TOK_IDENT, zz_tree_string(tree, name));
+	c[2] = args;
+	return zz_node_shared(tree, TOK_FUNC, zz_null, c, 3);
+}
+
+static void run(const char *prefix, int shared)
+{
+	struct zz_tree tree, source;
+	struct bench start;
+	struct zz_node *root, *copy;
+	char name[64], buf[16];
+	size_t i;
+
+	zz_tree_init_flags(&tree, shared ? sizeof(struct zz_shared_node) :
+			sizeof(struct zz_node),
+			ZZ_TREE_STRING_POOL | (shared ? ZZ_TREE_SHARED : 0));
+	bench_start(&start);
+	for (i = 0; i < COUNT; ++i) {
+		snprintf(buf, sizeof(buf), "f%zu", i);
+		if (shared)
+			build_shared(&tree, buf);
+		else
+			build(&tree, buf);
+	}
+	snprintf(name, sizeof(name), "%s_build", prefix);
+	bench_report(name, COUNT * 12, &start);
+
+	/* Copy the same function again and again */
+	zz_tree_init(&source, sizeof(struct zz_node));
+	root = build(&source, "main");
+	bench_start(&start);
+	for (i = 0; i < COUNT; ++i) {
+		copy = zz_copy_recursive(&tree, root);
+		if (!shared)
+			zz_destroy(copy);
+	}
+	snprintf(name, sizeof(name), "%s_copy", prefix);
+	bench_report(name, COUNT * 12, &start);
+	if (shared && copy != zz_copy_recursive(&tree, root))
+		abort();
+	zz_tree_destroy(&source);
+
+	bench_start(&start);
+	zz_tree_destroy(&tree);
+	snprintf(name, sizeof(name), "%s_destroy", prefix);
+	bench_report(name, COUNT * 12, &start);
+}
+
+int main(int argc, char *argv[])
+{
+	/* Shared first, so that its peak RSS doesn't count memory that copies
+	 * leave resident */
+	run("shared", 1);
+	run("unshared", 0);
+	exit(EXIT_SUCCESS);
+}
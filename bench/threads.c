@@ -0,0 +1,58 @@
+/*
+ * Scalability of the concurrent string dictionary: every thread builds its
+ * own tree full of identifiers, as when parsing many files in parallel
+ */
+
+#include <pthread.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+#include "bench.h"
+
+#define MAX_THREADS 8
+#define NODES 200000
+
+static const char *TOK_IDENT = "ident";
+
+static void *build_tree(void *arg)
+{
+	struct zz_tree tree;
+	struct zz_node *root;
+	char buf[32];
+	size_t i, seed = (size_t)arg;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	root = zz_node(&tree, TOK_IDENT, zz_null);
+	for (i = 0; i < NODES; ++i) {
+		snprintf(buf, sizeof(buf), "ident_%zu", (i * 7919 + seed) % (NODES / 4));
+		zz_append_child(root, zz_node(&tree, TOK_IDENT, zz_string(buf)));
+	}
+	zz_tree_destroy(&tree);
+	return NULL;
+}
+
+static void run(const char *name, size_t nthreads)
+{
+	pthread_t threads[MAX_THREADS];
+	struct bench start;
+	size_t i;
+
+	bench_start(&start);
+	for (i = 0; i < nthreads; ++i)
+		pthread_create(&threads[i], NULL, build_tree, (void *)i);
+	for (i = 0; i < nthreads; ++i)
+		pthread_join(threads[i], NULL);
+	bench_report(name, NODES * nthreads, &start);
+}
+
+int main(int argc, char *argv[])
+{
+	run("strings_single", 1);
+	zz_strings_set_concurrent(1);
+	run("strings_concurrent_1", 1);
+	run("strings_concurrent_2", 2);
+	run("strings_concurrent_4", 4);
+	run("strings_concurrent_8", 8);
+	zz_strings_set_concurrent(0);
+	exit(EXIT_SUCCESS);
+}
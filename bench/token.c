@@ -0,0 +1,138 @@
+/*
+ * Dispatch on the token of every node of a tree: chains of comparisons of
+ * token addresses against switches and tables indexed by token numbers
+ */
+
+#include <stdio.h>
+
+#include "../src/zebu.h"
+#include "bench.h"
+
+#define COUNT 1000000
+#define TOKENS 16
+#define ROUNDS 10
+
+static const char *const NAMES[TOKENS] = {
+	"func", "type", "ident", "arglist", "arg", "pointer", "body", "call",
+	"string", "int", "if", "while", "return", "assign", "binop", "unop"
+};
+
+static const char *tokens[TOKENS];
+static long counts[TOKENS];
+
+static long chain(struct zz_node **nodes)
+{
+	long s = 0;
+	size_t i;
+
+	for (i = 0; i < COUNT; ++i) {
+		const char *t = nodes[i]->token;
+		if (t == tokens[0]) s += 1;
+		else if (t == tokens[1]) s += 2;
+		else if (t == tokens[2]) s += 3;
+		else if (t == tokens[3]) s += 4;
+		else if (t == tokens[4]) s += 5;
+		else if (t == tokens[5]) s += 6;
+		else if (t == tokens[6]) s += 7;
+		else if (t == tokens[7]) s += 8;
+		else if (t == tokens[8]) s += 9;
+		else if (t == tokens[9]) s += 10;
+		else if (t == tokens[10]) s += 11;
+		else if (t == tokens[11]) s += 12;
+		else if (t == tokens[12]) s += 13;
+		else if (t == tokens[13]) s += 14;
+		else if (t == tokens[14]) s += 15;
+		else if (t == tokens[15]) s += 16;
+	}
+	return s;
+}
+
+static long dispatch(struct zz_node **nodes)
+{
+	long s = 0;
+	size_t i;
+
+	for (i = 0; i < COUNT; ++i) {
+		switch (zz_get_token_id(nodes[i])) {
+		case 0: s += 1; break;
+		case 1: s += 2; break;
+		case 2: s += 3; break;
+		case 3: s += 4; break;
+		case 4: s += 5; break;
+		case 5: s += 6; break;
+		case 6: s += 7; break;
+		case 7: s += 8; break;
+		case 8: s += 9; break;
+		case 9: s += 10; break;
+		case 10: s += 11; break;
+		case 11: s += 12; break;
+		case 12: s += 13; break;
+		case 13: s += 14; break;
+		case 14: s += 15; break;
+		case 15: s += 16; break;
+		}
+	}
+	return s;
+}
+
+static long histogram(struct zz_node **nodes)
+{
+	long s = 0;
+	size_t i;
+
+	for (i = 0; i < COUNT; ++i)
+		++counts[zz_get_token_id(nodes[i])];
+	for (i = 0; i < TOKENS; ++i)
+		s += counts[i] * (i + 1);
+	for (i = 0; i < TOKENS; ++i)
+		counts[i] = 0;
+	return s;
+}
+
+static void run(const char *name, long (*f)(struct zz_node **),
+		struct zz_node **nodes, long expected)
+{
+	struct bench start;
+	long total;
+	size_t i;
+
+	bench_start(&start);
+	total = 0;
+	for (i = 0; i < ROUNDS; ++i)
+		total += f(nodes);
+	bench_report(name, COUNT * ROUNDS, &start);
+	if (total != expected)
+		abort();
+}
+
+int main(int argc, char *argv[])
+{
+	struct zz_tokens t;
+	struct zz_tree tree;
+	struct zz_node **nodes;
+	long expected;
+	size_t i, k;
+
+	zz_tokens_init(&t);
+	for (i = 0; i < TOKENS; ++i)
+		tokens[i] = zz_tokens_add(&t, NAMES[i]);
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	nodes = malloc(COUNT * sizeof(*nodes));
+	srand(1);
+	expected = 0;
+	for (i = 0; i < COUNT; ++i) {
+		k = rand() % TOKENS;
+		nodes[i] = zz_node(&tree, tokens[k], zz_null);
+		expected += k + 1;
+	}
+	expected *= ROUNDS;
+
+	run("token_if_chain", chain, nodes, expected);
+	run("token_switch", dispatch, nodes, expected);
+	run("token_histogram", histogram, nodes, expected);
+
+	free(nodes);
+	zz_tree_destroy(&tree);
+	zz_tokens_destroy(&t);
+	exit(EXIT_SUCCESS);
+}
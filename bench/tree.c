@@ -0,0 +1,107 @@
+/*
+ * Synthetic workloads for the whole life of a tree: build, copy, print and
+ * destroy, on balanced trees and on trees full of identifiers
+ */
+
+#include <stdio.h>
+
+#include "../src/zebu.h"
+#include "bench.h"
+
+#define COUNT 1000000
+#define FANOUT 4
+#define IDENTS 10000
+
+static const char *TOK_EXPR = "expr";
+static const char *TOK_IDENT = "ident";
+
+/* Build a tree of COUNT nodes where every node has FANOUT children, filled
+ * level by level; ``nodes`` must have room for COUNT nodes */
+static struct zz_node *build_balanced(struct zz_tree *tree,
+		struct zz_node **nodes, int idents)
+{
+	char buf[32];
+	size_t i;
+
+	for (i = 0; i < COUNT; ++i) {
+		if (idents) {
+			snprintf(buf, sizeof(buf), "ident_%zu", i * 7919 % IDENTS);
+			nodes[i] = zz_node(tree, TOK_IDENT, zz_string(buf));
+		} else {
+			nodes[i] = zz_node(tree, TOK_EXPR, zz_int(i));
+		}
+		if (i > 0)
+			zz_append_child(nodes[(i - 1) / FANOUT], nodes[i]);
+	}
+	return nodes[0];
+}
+
+static void run(const char *prefix, int idents)
+{
+	struct zz_tree tree;
+	struct zz_node **nodes, *root, *copy;
+	struct bench start;
+	char name[64];
+	FILE *f;
+
+	nodes = malloc(COUNT * sizeof(*nodes));
+	zz_tree_init(&tree, sizeof(struct zz_node));
+
+	bench_start(&start);
+	root = build_balanced(&tree, nodes, idents);
+	snprintf(name, sizeof(name), "%s_build", prefix);
+	bench_report(name, COUNT, &start);
+
+	bench_start(&start);
+	copy = zz_copy_recursive(&tree, root);
+	snprintf(name, sizeof(name), "%s_copy_recursive", prefix);
+	bench_report(name, COUNT, &start);
+
+	f = fopen("/dev/null", "w");
+	bench_start(&start);
+	zz_print(copy, f);
+	snprintf(name, sizeof(name), "%s_print", prefix);
+	bench_report(name, COUNT, &start);
+	fclose(f);
+
+	bench_start(&start);
+	zz_destroy(copy);
+	snprintf(name, sizeof(name), "%s_destroy", prefix);
+	bench_report(name, COUNT, &start);
+
+	bench_start(&start);
+	zz_tree_destroy(&tree);
+	snprintf(name, sizeof(name), "%s_tree_destroy", prefix);
+	bench_report(name, COUNT, &start);
+
+	free(nodes);
+}
+
+/* Intern COUNT strings drawn from ``distinct`` different ones */
+static void intern(const char *name, size_t distinct)
+{
+	struct zz_data *data;
+	struct bench start;
+	char buf[32];
+	size_t i;
+
+	data = malloc(COUNT * sizeof(*data));
+	bench_start(&start);
+	for (i = 0; i < COUNT; ++i) {
+		snprintf(buf, sizeof(buf), "ident_%zu", i * 7919 % distinct);
+		data[i] = zz_string(buf);
+	}
+	bench_report(name, COUNT, &start);
+	for (i = 0; i < COUNT; ++i)
+		zz_data_destroy(data[i]);
+	free(data);
+}
+
+int main(int argc, char *argv[])
+{
+	run("balanced", 0);
+	run("idents", 1);
+	intern("string_intern_unique", COUNT);
+	intern("string_intern_repeated", IDENTS);
+	exit(EXIT_SUCCESS);
+}
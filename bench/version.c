@@ -0,0 +1,96 @@
+/*
+ * Keep versions of a large tree, changing one node in each, as snapshots
+ * copied with zz_copy_recursive() and as persistent versions that copy only
+ * the path to the changed node
+ */
+
+#include <stdio.h>
+
+#include "../src/zebu.h"
+#include "bench.h"
+
+#define FUNCS 1000
+#define STMTS 1000
+#define SNAPSHOTS 20
+#define VERSIONS 100000
+/* Versions kept alive at the same time */
+#define LIVE 16
+
+static const char *TOK_FILE = "file";
+static const char *TOK_FUNC = "func";
+static const char *TOK_STMT = "stmt";
+
+static struct zz_node *build(struct zz_tree *tree)
+{
+	struct zz_node *file, *func;
+	int i, j;
+
+	file = zz_node(tree, TOK_FILE, zz_null);
+	for (i = 0; i < FUNCS; ++i) {
+		func = zz_node(tree, TOK_FUNC, zz_int(i));
+		zz_append_child(file, func);
+		for (j = 0; j < STMTS; ++j)
+			zz_append_child(func, zz_node(tree, TOK_STMT,
+						zz_int(i * STMTS + j)));
+	}
+	return file;
+}
+
+static void snapshots(void)
+{
+	struct zz_tree tree;
+	struct bench start;
+	struct zz_node *root, *copy;
+	size_t i;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	root = build(&tree);
+	bench_start(&start);
+	for (i = 0; i < SNAPSHOTS; ++i) {
+		copy = zz_copy_recursive(&tree, root);
+		zz_set_int(zz_child(zz_child(copy, i * 37 % FUNCS),
+					i * 101 % STMTS), -1);
+		zz_destroy(root);
+		root = copy;
+	}
+	bench_report("version_snapshot", SNAPSHOTS, &start);
+	zz_tree_destroy(&tree);
+}
+
+static void versions(void)
+{
+	struct zz_tree tree, source;
+	struct bench start;
+	struct zz_node *live[LIVE], *v;
+	size_t path[2], i;
+
+	zz_tree_init(&source, sizeof(struct zz_node));
+	zz_tree_init_flags(&tree, sizeof(struct zz_shared_node), ZZ_TREE_SHARED);
+	v = zz_copy_recursive(&tree, build(&source));
+	zz_tree_destroy(&source);
+	for (i = 0; i < LIVE; ++i)
+		live[i] = zz_version(v);
+	zz_version_release(v);
+	bench_start(&start);
+	for (i = 0; i < VERSIONS; ++i) {
+		path[0] = i * 37 % FUNCS;
+		path[1] = i * 101 % STMTS;
+		v = zz_version_set_data(live[(i + LIVE - 1) % LIVE], path, 2,
+				zz_int(-1));
+		zz_version_release(live[i % LIVE]);
+		live[i % LIVE] = v;
+	}
+	bench_report("version_persistent", VERSIONS, &start);
+	for (i = 0; i < LIVE; ++i)
+		zz_version_release(live[i]);
+	zz_tree_destroy(&tree);
+}
+
+int main(int argc, char *argv[])
+{
+	/* Persistent first, so that its peak RSS doesn't count memory that
+	 * snapshots leave resident */
+	versions();
+	snapshots();
+	exit(EXIT_SUCCESS);
+}
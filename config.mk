@@ -19,6 +19,9 @@ ALL_LDFLAGS = $(LDFLAGS)
 
 ALL_CFLAGS += -std=gnu99
 ALL_CFLAGS += -fPIC
+ALL_CFLAGS += -pthread
+
+ALL_LDFLAGS += -pthread
 
 QUIET_CC = @echo CC $@;
 QUIET_LINK = @echo LINK $@;
@@ -34,7 +37,7 @@ QUIET_GEN = @echo GEN $@;
 	$(QUIET_CC)$(CC) $(ALL_CFLAGS) -c $<
 
 lib%.so:
-	$(QUIET_LINK)$(CC) -shared -Wl,-soname,$@.$(version) -o $@ $^
+	$(QUIET_LINK)$(CC) -shared $(ALL_LDFLAGS) -Wl,-soname,$@.$(version) -o $@ $^
 
 lib%.a:
 	$(QUIET_AR)$(AR) rcs $@ $^
@@ -0,0 +1,17 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#include "allocator.h"
+
+static void *default_alloc(void *data, size_t size)
+{
+	return malloc(size);
+}
+
+static void default_free(void *data, void *ptr, size_t size)
+{
+	free(ptr);
+}
+
+const struct zz_allocator zz_default_allocator = {
+	default_alloc, default_free, NULL, NULL
+};
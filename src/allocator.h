@@ -0,0 +1,58 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#ifndef ZEBU_ALLOCATOR_H_
+#define ZEBU_ALLOCATOR_H_
+
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Allocator
+ * ---------
+ *
+ * Hooks to get memory for trees from somewhere other than malloc().
+ *
+ * A tree gets from its allocator the chunks of its arenas and the table of its
+ * string pool. If ``release`` is not ``NULL``, zz_tree_destroy() calls it once
+ * instead of freeing each block, so region allocators can drop everything at
+ * once; ``release`` must then free everything ``alloc`` returned for the tree.
+ */
+
+/**
+ * Table of allocation functions; ``data`` is passed to all of them
+ */
+struct zz_allocator {
+	void *(*alloc)(void *data, size_t size);
+	void (*free)(void *data, void *ptr, size_t size);
+	void (*release)(void *data);
+	void *data;
+};
+
+/**
+ * Allocator based on malloc() and free(), used by default
+ */
+extern const struct zz_allocator zz_default_allocator;
+
+/**
+ * Allocate ``size`` bytes from ``a``
+ */
+static inline void *zz_alloc(const struct zz_allocator *a, size_t size)
+{
+	return a->alloc(a->data, size);
+}
+/**
+ * Return ``ptr``, of ``size`` bytes, to ``a``
+ */
+static inline void zz_free(const struct zz_allocator *a, void *ptr, size_t size)
+{
+	a->free(a->data, ptr, size);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif       // ZEBU_ALLOCATOR_H_
@@ -0,0 +1,87 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#include "arena.h"
+
+#define HEADER_SIZE zz_arena_align(sizeof(struct zz_arena_chunk))
+
+void zz_arena_init(struct zz_arena *a, size_t chunk_size,
+		const struct zz_allocator *allocator)
+{
+	a->chunks = NULL;
+	a->spare = NULL;
+	a->ptr = NULL;
+	a->end = NULL;
+	a->chunk_size = chunk_size;
+	a->allocated = 0;
+	a->allocator = allocator;
+}
+
+static void free_chunks(struct zz_arena *a, struct zz_arena_chunk *c)
+{
+	struct zz_arena_chunk *x;
+	for (; c != NULL; c = x) {
+		x = c->next;
+		zz_free(a->allocator, c, c->size);
+	}
+}
+
+void zz_arena_destroy(struct zz_arena *a)
+{
+	free_chunks(a, a->chunks);
+	free_chunks(a, a->spare);
+	a->chunks = NULL;
+	a->spare = NULL;
+	a->ptr = NULL;
+	a->end = NULL;
+	a->allocated = 0;
+}
+
+void zz_arena_reset(struct zz_arena *a)
+{
+	struct zz_arena_chunk *c;
+
+	while (a->chunks != NULL) {
+		c = a->chunks;
+		a->chunks = c->next;
+		c->next = a->spare;
+		a->spare = c;
+	}
+	a->ptr = NULL;
+	a->end = NULL;
+}
+
+void *zz_arena_grow(struct zz_arena *a, size_t size)
+{
+	struct zz_arena_chunk *c;
+	size_t chunk_size;
+
+	if (a->chunks != NULL)
+		a->chunks->used = a->ptr - (char *)a->chunks;
+	if (a->spare != NULL && a->spare->size >= HEADER_SIZE + size) {
+		c = a->spare;
+		a->spare = c->next;
+	} else {
+		chunk_size = a->chunk_size;
+		if (chunk_size < HEADER_SIZE + size)
+			chunk_size = HEADER_SIZE + size;
+		c = zz_alloc(a->allocator, chunk_size);
+		if (c == NULL)
+			return NULL;
+		c->size = chunk_size;
+		a->allocated += chunk_size;
+		if (a->chunk_size < ZZ_ARENA_MAX_CHUNK_SIZE)
+			a->chunk_size *= 2;
+	}
+	c->next = a->chunks;
+	a->chunks = c;
+	a->ptr = (char *)c + HEADER_SIZE + size;
+	a->end = (char *)c + c->size;
+	return (char *)c + HEADER_SIZE;
+}
+
+void zz_arena_reserve(struct zz_arena *a, size_t size)
+{
+	size = zz_arena_align(size);
+	if ((size_t)(a->end - a->ptr) < size)
+		a->ptr = zz_arena_grow(a, size);
+}
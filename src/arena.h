@@ -0,0 +1,121 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#ifndef ZEBU_ARENA_H_
+#define ZEBU_ARENA_H_
+
+#include <stdlib.h>
+
+#include "allocator.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Arena
+ * -----
+ *
+ * Bump allocator that carves objects out of large chunks and releases all of
+ * them at once.
+ *
+ * Chunks start at the size given to zz_arena_init() and double every time a
+ * new one is required, up to ``ZZ_ARENA_MAX_CHUNK_SIZE``; objects larger than
+ * that get a chunk of their own.
+ *
+ * zz_arena_reset() releases all objects but keeps the chunks as spares, that
+ * are used again before asking the allocator for more memory.
+ */
+
+/**
+ * Alignment of every object returned by the arena
+ */
+#define ZZ_ARENA_ALIGN 16
+/**
+ * Upper limit for the size of chunks
+ */
+#define ZZ_ARENA_MAX_CHUNK_SIZE ((size_t)4 << 20)
+
+/**
+ * Header of a chunk; objects are allocated right after it
+ */
+struct zz_arena_chunk {
+	struct zz_arena_chunk *next;
+	size_t size;
+	size_t used;
+};
+
+/**
+ * Linked lists of chunks in use and spare, the free space left in the current
+ * one, the total size of all chunks, and where they come from
+ */
+struct zz_arena {
+	struct zz_arena_chunk *chunks;
+	struct zz_arena_chunk *spare;
+	char *ptr;
+	char *end;
+	size_t chunk_size;
+	size_t allocated;
+	const struct zz_allocator *allocator;
+};
+
+/**
+ * Round ``size`` up to a multiple of ``ZZ_ARENA_ALIGN``
+ */
+static inline size_t zz_arena_align(size_t size)
+{
+	return (size + ZZ_ARENA_ALIGN - 1) & ~(size_t)(ZZ_ARENA_ALIGN - 1);
+}
+/**
+ * Start and end of the objects allocated from chunk ``c``
+ */
+static inline char *zz_arena_chunk_begin(struct zz_arena_chunk *c)
+{
+	return (char *)c + zz_arena_align(sizeof(*c));
+}
+static inline char *zz_arena_chunk_end(struct zz_arena *a,
+		struct zz_arena_chunk *c)
+{
+	return c == a->chunks ? a->ptr : (char *)c + c->used;
+}
+/**
+ * Initialize arena to get chunks from ``allocator``; no memory is allocated
+ * until the first object is
+ */
+void zz_arena_init(struct zz_arena *a, size_t chunk_size,
+		const struct zz_allocator *allocator);
+/**
+ * Release all chunks
+ */
+void zz_arena_destroy(struct zz_arena *a);
+/**
+ * Release all objects, but keep the chunks for reuse
+ */
+void zz_arena_reset(struct zz_arena *a);
+/**
+ * Allocate a new chunk big enough to hold ``size`` bytes; used by
+ * zz_arena_alloc() when the current one is full
+ */
+void *zz_arena_grow(struct zz_arena *a, size_t size);
+/**
+ * Make sure that the next ``size`` bytes can be allocated from the current
+ * chunk, so that many objects allocated together are contiguous
+ */
+void zz_arena_reserve(struct zz_arena *a, size_t size);
+/**
+ * Allocate ``size`` bytes; the memory is not initialized
+ */
+static inline void *zz_arena_alloc(struct zz_arena *a, size_t size)
+{
+	char *p = a->ptr;
+	size = zz_arena_align(size);
+	if ((size_t)(a->end - p) < size)
+		return zz_arena_grow(a, size);
+	a->ptr = p + size;
+	return p;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif       // ZEBU_ARENA_H_
@@ -2,29 +2,184 @@
 
 #include "data.h"
 
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
 #include "dict.h"
 
-static struct zz_dict *strings = NULL;
+/* Strings are spread among 1 << SHARD_BITS dictionaries, chosen by the top
+ * bits of their hash; the low bits index the buckets inside each of them. */
+#define SHARD_BITS 6
+#define SHARD(hash) (&shards[(hash) >> (sizeof(size_t) * 8 - SHARD_BITS)])
+
+struct shard {
+	pthread_mutex_t lock;
+	struct zz_dict *strings;
+	size_t hits;
+	size_t misses;
+} __attribute__((aligned(64)));
+
+static struct shard shards[1 << SHARD_BITS];
+
+static int concurrent = 0;
 
 const struct zz_data zz_null = { ZZ_NULL };
 
+void zz_strings_set_concurrent(int enable)
+{
+	static int initialized = 0;
+	size_t i;
+
+	if (enable && !initialized) {
+		for (i = 0; i < sizeof(shards) / sizeof(*shards); ++i)
+			pthread_mutex_init(&shards[i].lock, NULL);
+		initialized = 1;
+	}
+	concurrent = enable;
+}
+
 struct zz_data zz_string(const char *str)
+{
+	return zz_string_n(str, strlen(str));
+}
+
+struct zz_data zz_string_n(const char *str, size_t length)
+{
+	struct zz_data data = { ZZ_STRING };
+	size_t hash = zz_dict_hash(str, length);
+	struct shard *s = SHARD(hash);
+	size_t count;
+
+	if (concurrent)
+		pthread_mutex_lock(&s->lock);
+	count = s->strings ? s->strings->count : 0;
+	s->strings = zz_dict_insert_hash(s->strings, str, length, hash,
+			&data.data.string_val);
+	if (s->strings->count > count)
+		++s->misses;
+	else
+		++s->hits;
+	if (concurrent)
+		pthread_mutex_unlock(&s->lock);
+	return data;
+}
+
+struct zz_data zz_string_inline(const char *str, size_t length)
 {
 	struct zz_data data = { ZZ_STRING };
-	strings = zz_dict_insert(strings, str, &data.data.string_val);
+
+	if (length > ZZ_INLINE_STRING_MAX)
+		return zz_string_n(str, length);
+	data.inline_size = length + 1;
+	memcpy(data.data.inline_val, str, length);
 	return data;
 }
 
+void zz_strings_stats(struct zz_dict_stats *stats)
+{
+	struct shard *s;
+	size_t i;
+
+	memset(stats, 0, sizeof(*stats));
+	for (i = 0; i < sizeof(shards) / sizeof(*shards); ++i) {
+		s = &shards[i];
+		if (concurrent)
+			pthread_mutex_lock(&s->lock);
+		zz_dict_stats(s->strings, stats);
+		stats->hits += s->hits;
+		stats->misses += s->misses;
+		if (concurrent)
+			pthread_mutex_unlock(&s->lock);
+	}
+}
+
 void zz_data_destroy(struct zz_data x)
 {
-	if (x.type == ZZ_STRING)
-		strings = zz_dict_delete(strings, x.data.string_val);
+	struct zz_dict_entry *e;
+	struct shard *s;
+	size_t count;
+
+	if (x.type != ZZ_STRING || x.inline_size != 0 ||
+			zz_dict_pooled(x.data.string_val))
+		return;
+	e = zz_dict_entry(x.data.string_val);
+	s = SHARD(e->hash);
+	if (!concurrent) {
+		s->strings = zz_dict_unref(s->strings, x.data.string_val);
+		return;
+	}
+	/* Drop references without locking unless this may be the last one;
+	 * only then the string may be removed, and that must be serialized
+	 * with lookups that could revive it. */
+	count = __atomic_load_n(&e->ref_count, __ATOMIC_RELAXED);
+	while (count > 1) {
+		if (__atomic_compare_exchange_n(&e->ref_count, &count, count - 1,
+					0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+			return;
+	}
+	pthread_mutex_lock(&s->lock);
+	s->strings = zz_dict_unref(s->strings, x.data.string_val);
+	pthread_mutex_unlock(&s->lock);
 }
 
 struct zz_data zz_data_copy(struct zz_data x)
 {
-	struct zz_data y = x;
-	if (x.type == ZZ_STRING)
-		strings = zz_dict_insert(strings, x.data.string_val, &y.data.string_val);
-	return y;
+	if (x.type == ZZ_STRING && x.inline_size == 0)
+		zz_dict_ref(x.data.string_val);
+	return x;
+}
+
+int zz_data_equal(struct zz_data a, struct zz_data b)
+{
+	if (a.type != b.type)
+		return 0;
+	switch (a.type) {
+	case ZZ_NULL:
+		return 1;
+	case ZZ_INT:
+		return a.data.int_val == b.data.int_val;
+	case ZZ_UINT:
+		return a.data.uint_val == b.data.uint_val;
+	case ZZ_DOUBLE:
+		return memcmp(&a.data.double_val, &b.data.double_val,
+				sizeof(double)) == 0;
+	case ZZ_STRING:
+		if (a.inline_size == 0 && b.inline_size == 0 &&
+				a.data.string_val == b.data.string_val)
+			return 1;
+		return zz_string_length(a) == zz_string_length(b) &&
+			memcmp(zz_data_string(&a), zz_data_string(&b),
+					zz_string_length(a)) == 0;
+	case ZZ_POINTER:
+		return a.data.pointer_val == b.data.pointer_val;
+	}
+	return 0;
+}
+
+size_t zz_data_hash(struct zz_data x)
+{
+	unsigned long long bits = 0;
+
+	switch (x.type) {
+	case ZZ_NULL:
+		break;
+	case ZZ_INT:
+		bits = (unsigned int)x.data.int_val;
+		break;
+	case ZZ_UINT:
+		bits = x.data.uint_val;
+		break;
+	case ZZ_DOUBLE:
+		memcpy(&bits, &x.data.double_val, sizeof(bits));
+		break;
+	case ZZ_STRING:
+		if (x.inline_size != 0)
+			return zz_dict_hash(x.data.inline_val, x.inline_size - 1);
+		return zz_dict_entry(x.data.string_val)->hash;
+	case ZZ_POINTER:
+		bits = (uintptr_t)x.data.pointer_val;
+		break;
+	}
+	return (size_t)((bits + x.type) * 11400714819323198485ULL);
 }
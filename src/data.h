@@ -5,6 +5,8 @@
 
 #include <assert.h>
 
+#include "dict.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -31,6 +33,21 @@ extern "C" {
  *    +--------------------+
  *    | ``ZZ_POINTER``     |
  *    +--------------------+
+ *
+ * Strings of up to ``ZZ_INLINE_STRING_MAX`` characters may also be stored
+ * inline, in the data itself, by zz_string_inline(); they need no memory of
+ * their own, but are copied with the data, so they are not unique and must be
+ * compared by content, and they can only be read through a pointer to the
+ * data, with zz_data_string(). zz_to_string() gets a copy of the data, so it
+ * must only be given strings that are not inline, which zz_string() and
+ * zz_string_n() always return; code that may see inline strings must use
+ * zz_data_string() instead.
+ *
+ * Strings are interned in a dictionary shared by the whole process, that
+ * stores their length next to them, and are reference counted; by default,
+ * it must only be used from one thread at a time, but it can be switched to
+ * a concurrent mode in which it is split in several dictionaries, each
+ * protected by its own lock.
  */
 
 /**
@@ -45,18 +62,27 @@ enum zz_data_type {
 	ZZ_POINTER
 };
 
+/**
+ * Longest string that can be stored inline
+ */
+#define ZZ_INLINE_STRING_MAX 7
+
 /**
  * A field to indicate type and another to hold the data
  *
+ * ``inline_size`` is the length plus one of strings stored inline, and 0 for
+ * any other data; it fills the padding after ``type``.
  */
 struct zz_data {
 	enum zz_data_type type;
+	unsigned int inline_size;
 	union {
 		int int_val;
 		unsigned int uint_val;
 		double double_val;
 		const char *string_val;
 		void *pointer_val;
+		char inline_val[ZZ_INLINE_STRING_MAX + 1];
 	} data;
 };
 
@@ -70,21 +96,41 @@ extern const struct zz_data zz_null;
  */
 static inline struct zz_data zz_int(int data)
 {
-	return (struct zz_data){ ZZ_INT, { .int_val = data }};
+	return (struct zz_data){ ZZ_INT, 0, { .int_val = data }};
 }
 static inline struct zz_data zz_uint(unsigned int data)
 {
-	return (struct zz_data){ ZZ_UINT, { .uint_val = data }};
+	return (struct zz_data){ ZZ_UINT, 0, { .uint_val = data }};
 }
 static inline struct zz_data zz_double(double data)
 {
-	return (struct zz_data){ ZZ_DOUBLE, { .double_val = data }};
+	return (struct zz_data){ ZZ_DOUBLE, 0, { .double_val = data }};
 }
 struct zz_data zz_string(const char *data);
+/**
+ * Create string data from the first ``length`` characters of ``data``, that
+ * need not be NUL-terminated, like the text of a token given by a lexer
+ */
+struct zz_data zz_string_n(const char *data, size_t length);
+/**
+ * Create string data from the first ``length`` characters of ``data``, stored
+ * inline if there are no more than ``ZZ_INLINE_STRING_MAX``, or interned
+ * otherwise
+ */
+struct zz_data zz_string_inline(const char *data, size_t length);
 static inline struct zz_data zz_pointer(void *data)
 {
-	return (struct zz_data){ ZZ_POINTER, { .pointer_val = data }};
+	return (struct zz_data){ ZZ_POINTER, 0, { .pointer_val = data }};
 }
+/**
+ * Enable or disable the concurrent mode for the string dictionary; must be
+ * called while no other thread is creating or destroying data.
+ */
+void zz_strings_set_concurrent(int enable);
+/**
+ * Get statistics about the strings created by zz_string()
+ */
+void zz_strings_stats(struct zz_dict_stats *stats);
 /**
  * Destroy data
  */
@@ -93,6 +139,18 @@ void zz_data_destroy(struct zz_data x);
  * Copy data
  */
 struct zz_data zz_data_copy(struct zz_data x);
+/**
+ * Return 1 if ``a`` and ``b`` have the same type and value, and 0 otherwise.
+ * Strings are equal if they have the same characters, which for strings of
+ * the same dictionary or pool means the same address; doubles are compared
+ * bit by bit, and pointers by address.
+ */
+int zz_data_equal(struct zz_data a, struct zz_data b);
+/**
+ * Hash of data, equal for data that zz_data_equal() finds equal; strings are
+ * hashed by their characters, using the hash kept by the dictionary
+ */
+size_t zz_data_hash(struct zz_data x);
 /**
  * Cast data to type
  */
@@ -111,9 +169,13 @@ static inline double zz_to_double(struct zz_data x)
 	assert(x.type == ZZ_DOUBLE);
 	return x.data.double_val;
 }
+/**
+ * Get string of data that is not stored inline; a string stored inline has
+ * its characters in ``x`` and can only be read with zz_data_string()
+ */
 static inline const char *zz_to_string(struct zz_data x)
 {
-	assert(x.type == ZZ_STRING);
+	assert(x.type == ZZ_STRING && x.inline_size == 0);
 	return x.data.string_val;
 }
 static inline void *zz_to_pointer(struct zz_data x)
@@ -121,6 +183,35 @@ static inline void *zz_to_pointer(struct zz_data x)
 	assert(x.type == ZZ_POINTER);
 	return x.data.pointer_val;
 }
+/**
+ * Length of string data, without the terminating NUL; does not traverse the
+ * string
+ */
+static inline size_t zz_string_length(struct zz_data x)
+{
+	assert(x.type == ZZ_STRING);
+	if (x.inline_size != 0)
+		return x.inline_size - 1;
+	return zz_dict_length(x.data.string_val);
+}
+/**
+ * Return 1 if ``x`` is a string stored inline, and 0 otherwise
+ */
+static inline int zz_string_is_inline(struct zz_data x)
+{
+	return x.inline_size != 0;
+}
+/**
+ * Get string of data, whether it is stored inline or not; valid as long as
+ * ``x`` is
+ */
+static inline const char *zz_data_string(const struct zz_data *x)
+{
+	assert(x->type == ZZ_STRING);
+	if (x->inline_size != 0)
+		return x->data.inline_val;
+	return x->data.string_val;
+}
 
 #ifdef __cplusplus
 }
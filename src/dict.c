@@ -5,180 +5,284 @@
 #include <string.h>
 #include <unistd.h>
 
-#define MIN(a, b) ((a) < (b) ? (a) : (b))
+/* Number of buckets of a new dictionary */
+#define MIN_SIZE 16
 
-#define SWAP(a, b)\
-do {\
-	typeof(a) tmp = a;\
-	a = b;\
-	b = tmp;\
-} while (0)
+/* The table grows when more than 3/4 of the buckets are used */
+#define MAX_LOAD(size) ((size) / 4 * 3)
 
-static struct zz_dict *skew(struct zz_dict *t)
+#define TABLE_SIZE(size) \
+	(sizeof(struct zz_dict) + (size) * sizeof(struct zz_dict_bucket))
+#define ENTRY_SIZE(length) (sizeof(struct zz_dict_entry) + (length) + 1)
+
+static struct zz_dict *dict_alloc(size_t size,
+		const struct zz_allocator *allocator)
 {
-	struct zz_dict *l;
+	struct zz_dict *t;
+	t = zz_alloc(allocator, TABLE_SIZE(size));
+	memset(t, 0, TABLE_SIZE(size));
+	t->size = size;
+	t->allocator = allocator;
+	return t;
+}
 
-	if (t == NULL) {
-		return NULL;
-	} else if (t->left == NULL) {
-		return t;
-	} else if (t->left->level == t->level) {
-		l = t->left;
-		t->left = l->right;
-		l->right = t;
-		return l;
-	} else {
-		return t;
-	}
+static void dict_free(struct zz_dict *t)
+{
+	zz_free(t->allocator, t, TABLE_SIZE(t->size));
 }
 
-static struct zz_dict *split(struct zz_dict *t)
+/* Put entry in the first free bucket for its hash */
+static void dict_place(struct zz_dict *t, size_t hash, struct zz_dict_entry *e)
 {
-	struct zz_dict *r;
+	size_t mask = t->size - 1;
+	size_t i = hash & mask;
+	while (t->buckets[i].entry != NULL)
+		i = (i + 1) & mask;
+	t->buckets[i].hash = hash;
+	t->buckets[i].entry = e;
+}
 
-	if (t == NULL) {
-		return NULL;
-	} else if (t->right == NULL || t->right->right == NULL) {
-		return t;
-	} else if (t->level == t->right->right->level) {
-		r = t->right;
-		t->right = r->left;
-		r->left = t;
-		++r->level;
-		return r;
-	} else {
-		return t;
+static struct zz_dict *dict_grow(struct zz_dict *t)
+{
+	struct zz_dict *n;
+	size_t i;
+
+	n = dict_alloc(t->size * 2, t->allocator);
+	n->count = t->count;
+	n->bytes = t->bytes;
+	for (i = 0; i < t->size; ++i) {
+		if (t->buckets[i].entry != NULL)
+			dict_place(n, t->buckets[i].hash, t->buckets[i].entry);
 	}
+	dict_free(t);
+	return n;
 }
 
-static struct zz_dict *sucessor(struct zz_dict *t)
+/* Return index of the bucket holding ``data``, or ``t->size`` if missing */
+static size_t dict_find(struct zz_dict *t, size_t hash, const char *data,
+		size_t length)
 {
-	for (t = t->right; t->left; t = t->left)
-		continue;
-	return t;
+	size_t mask = t->size - 1;
+	size_t i = hash & mask;
+	struct zz_dict_bucket *b;
+
+	for (;;) {
+		b = &t->buckets[i];
+		if (b->entry == NULL)
+			return t->size;
+		if (b->hash == hash && b->entry->length == length &&
+				memcmp(b->entry->data, data, length) == 0)
+			return i;
+		i = (i + 1) & mask;
+	}
 }
 
-static struct zz_dict *predecessor(struct zz_dict *t)
+/* Empty bucket ``i`` and shift back the rest of its cluster */
+static struct zz_dict *dict_remove(struct zz_dict *t, size_t i)
 {
-	for (t = t->left; t->right; t = t->right)
-		continue;
+	size_t mask = t->size - 1;
+	size_t j, k;
+
+	t->bytes -= t->buckets[i].entry->length;
+	zz_free(t->allocator, t->buckets[i].entry,
+			ENTRY_SIZE(t->buckets[i].entry->length));
+	if (--t->count == 0) {
+		dict_free(t);
+		return NULL;
+	}
+	for (j = (i + 1) & mask; t->buckets[j].entry != NULL; j = (j + 1) & mask) {
+		k = t->buckets[j].hash & mask;
+		if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+			continue;
+		t->buckets[i] = t->buckets[j];
+		i = j;
+	}
+	t->buckets[i].entry = NULL;
 	return t;
 }
 
-static struct zz_dict *decrease_level(struct zz_dict *t)
+size_t zz_dict_hash(const char *data, size_t length)
 {
-	int right_level = t->right ? t->right->level : 0;
-	int left_level = t->left ? t->left->level : 0;
-	int should_be = MIN(left_level, right_level) + 1;
-	if (should_be < t->level) {
-		t->level = should_be;
-		if (should_be < right_level)
-			t->right->level = should_be;
+	/* 64-bit FNV-1a */
+	unsigned long long h = 14695981039346656037ULL;
+	size_t i;
+	for (i = 0; i < length; ++i) {
+		h ^= (unsigned char)data[i];
+		h *= 1099511628211ULL;
 	}
-	return t;
+	return (size_t)h;
 }
 
 int zz_dict_lookup(struct zz_dict *t, const char *data, const char **rval)
 {
-	int cmp;
+	size_t length, i;
 
-	while (t != NULL) {
-		cmp = strcmp(data, t->data);
-		if (cmp < 0) {
-			t = t->left;
-		} else if (cmp > 0) {
-			t = t->right;
-		} else {
-			if (rval != NULL)
-				*rval = t->data;
-			return 1;
-		}
-	}
-	return 0;
+	if (t == NULL)
+		return 0;
+	length = strlen(data);
+	i = dict_find(t, zz_dict_hash(data, length), data, length);
+	if (i == t->size)
+		return 0;
+	if (rval != NULL)
+		*rval = t->buckets[i].entry->data;
+	return 1;
 }
 
-struct zz_dict *zz_dict_insert(struct zz_dict *t, const char *data,
-		const char **rval)
+/* Insert in dictionary; the entry comes from ``arena`` if it is not NULL */
+static struct zz_dict *dict_insert(struct zz_dict *t, struct zz_arena *arena,
+		const char *data, size_t length, size_t hash, const char **rval)
 {
-	int cmp;
+	struct zz_dict_entry *e;
+	size_t i;
 
 	if (t == NULL) {
-		t = calloc(1, sizeof(*t));
-		t->level = 1;
-		t->ref_count = 1;
-		t->data = strdup(data);
-		if (rval != NULL)
-			*rval = t->data;
-		return t;
+		t = dict_alloc(MIN_SIZE, arena != NULL ? arena->allocator :
+				&zz_default_allocator);
+	} else {
+		i = dict_find(t, hash, data, length);
+		if (i != t->size) {
+			e = t->buckets[i].entry;
+			zz_dict_ref(e->data);
+			if (rval != NULL)
+				*rval = e->data;
+			return t;
+		}
+		if (t->count + 1 > MAX_LOAD(t->size))
+			t = dict_grow(t);
 	}
-	cmp = strcmp(data, t->data);
-	if (cmp < 0) {
-		t->left = zz_dict_insert(t->left, data, rval);
-	} else if (cmp > 0) {
-		t->right = zz_dict_insert(t->right, data, rval);
+	if (arena != NULL) {
+		e = zz_arena_alloc(arena, ENTRY_SIZE(length));
+		e->ref_count = 0;
 	} else {
-		++t->ref_count;
-		if (rval != NULL)
-			*rval = t->data;
+		e = zz_alloc(t->allocator, ENTRY_SIZE(length));
+		e->ref_count = 1;
 	}
-	t = skew(t);
-	t = split(t);
+	e->hash = hash;
+	e->length = length;
+	memcpy(e->data, data, length);
+	e->data[length] = 0;
+	dict_place(t, hash, e);
+	++t->count;
+	t->bytes += length;
+	if (rval != NULL)
+		*rval = e->data;
 	return t;
 }
 
+struct zz_dict *zz_dict_insert(struct zz_dict *t, const char *data,
+		const char **rval)
+{
+	size_t length = strlen(data);
+	return dict_insert(t, NULL, data, length, zz_dict_hash(data, length),
+			rval);
+}
+
+struct zz_dict *zz_dict_insert_n(struct zz_dict *t, const char *data,
+		size_t length, const char **rval)
+{
+	return dict_insert(t, NULL, data, length, zz_dict_hash(data, length),
+			rval);
+}
+
+struct zz_dict *zz_dict_insert_hash(struct zz_dict *t, const char *data,
+		size_t length, size_t hash, const char **rval)
+{
+	return dict_insert(t, NULL, data, length, hash, rval);
+}
+
+struct zz_dict *zz_dict_intern(struct zz_dict *t, struct zz_arena *arena,
+		const char *data, const char **rval)
+{
+	return zz_dict_intern_n(t, arena, data, strlen(data), rval);
+}
+
+struct zz_dict *zz_dict_intern_n(struct zz_dict *t, struct zz_arena *arena,
+		const char *data, size_t length, const char **rval)
+{
+	return dict_insert(t, arena, data, length, zz_dict_hash(data, length),
+			rval);
+}
+
 struct zz_dict *zz_dict_delete(struct zz_dict *t, const char *data)
 {
-	int cmp;
+	size_t length, i;
 
 	if (t == NULL)
 		return t;
-	cmp = strcmp(data, t->data);
-	if (cmp > 0) {
-		t->right = zz_dict_delete(t->right, data);
-	} else if (cmp < 0) {
-		t->left = zz_dict_delete(t->left, data);
-	} else {
-		if (t->ref_count > 1) {
-			--t->ref_count;
-			return t;
-		}
-		if (t->left == NULL) {
-			if (t->right == NULL) {
-				free(t->data);
-				free(t);
-				return NULL;
-			}
-			struct zz_dict *l = sucessor(t);
-			SWAP(t->data, l->data);
-			SWAP(t->ref_count, l->ref_count);
-			t->right = zz_dict_delete(t->right, l->data);
-		} else {
-			struct zz_dict *l = predecessor(t);
-			SWAP(t->data, l->data);
-			SWAP(t->ref_count, l->ref_count);
-			t->left = zz_dict_delete(t->left, l->data);
-		}
+	length = strlen(data);
+	i = dict_find(t, zz_dict_hash(data, length), data, length);
+	if (i == t->size)
+		return t;
+	return zz_dict_unref(t, t->buckets[i].entry->data);
+}
+
+struct zz_dict *zz_dict_unref(struct zz_dict *t, const char *data)
+{
+	struct zz_dict_entry *e = zz_dict_entry(data);
+	size_t mask, i;
+
+	if (zz_dict_pooled(data) ||
+			__atomic_sub_fetch(&e->ref_count, 1, __ATOMIC_ACQ_REL) > 0)
+		return t;
+	mask = t->size - 1;
+	for (i = e->hash & mask; t->buckets[i].entry != e; i = (i + 1) & mask)
+		continue;
+	return dict_remove(t, i);
+}
+
+void zz_dict_stats(const struct zz_dict *t, struct zz_dict_stats *stats)
+{
+	size_t mask, depth, i;
+
+	if (t == NULL)
+		return;
+	stats->count += t->count;
+	stats->bytes += t->bytes;
+	stats->memory += TABLE_SIZE(t->size) +
+		t->count * ENTRY_SIZE(0) + t->bytes;
+	mask = t->size - 1;
+	for (i = 0; i < t->size; ++i) {
+		if (t->buckets[i].entry == NULL)
+			continue;
+		depth = ((i - t->buckets[i].hash) & mask) + 1;
+		if (depth > stats->max_depth)
+			stats->max_depth = depth;
 	}
+}
 
-	/* Rebalance the tree. Decrease the level of all nodes in this level if
-	 * necessary, and then skew and split all nodes in the new level. */
-	t = decrease_level(t);
-	t = skew(t);
-	t->right = skew(t->right);
-	if (t->right != NULL)
-		t->right->right = skew(t->right->right);
-	t = split(t);
-	t->right = split(t->right);
-	return t;
+size_t zz_dict_table_size(const struct zz_dict *t)
+{
+	return t != NULL ? TABLE_SIZE(t->size) : 0;
+}
+
+void zz_dict_clear(struct zz_dict *t)
+{
+	size_t i;
+
+	if (t == NULL)
+		return;
+	for (i = 0; i < t->size; ++i) {
+		if (t->buckets[i].entry != NULL &&
+				t->buckets[i].entry->ref_count != 0)
+			zz_free(t->allocator, t->buckets[i].entry,
+					ENTRY_SIZE(t->buckets[i].entry->length));
+	}
+	memset(t->buckets, 0, t->size * sizeof(struct zz_dict_bucket));
+	t->count = 0;
+	t->bytes = 0;
 }
 
 void zz_dict_destroy(struct zz_dict *t)
 {
+	size_t i;
+
 	if (t != NULL) {
-		zz_dict_destroy(t->left);
-		zz_dict_destroy(t->right);
-		free(t->data);
-		free(t);
+		for (i = 0; i < t->size; ++i) {
+			if (t->buckets[i].entry != NULL &&
+					t->buckets[i].entry->ref_count != 0)
+				zz_free(t->allocator, t->buckets[i].entry,
+						ENTRY_SIZE(t->buckets[i].entry->length));
+		}
+		dict_free(t);
 	}
 }
-
@@ -4,6 +4,9 @@
 #define ZEBU_DICT_H_
 
 #include <stdlib.h>
+#include <stddef.h>
+
+#include "arena.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -13,23 +16,86 @@ extern "C" {
  * Dict
  * ----
  *
- * Dictionary of strings allocated by Zebu ASTs; implemented as an AA tree.
+ * Dictionary of strings allocated by Zebu ASTs; implemented as a hash table
+ * with open addressing and linear probing.
+ *
+ * Strings are reference counted, and stored in a single block together with
+ * their hash and length. Each bucket in the table keeps a copy of the hash, so
+ * that probing only touches the strings whose hash matches. Deletion shifts
+ * back the following entries in the cluster instead of leaving tombstones.
+ *
+ * An empty dictionary is represented by ``NULL``; the functions that modify it
+ * return the new dictionary, that may have been reallocated.
  *
- * An AA Tree is a simplified form of red-black tree that implements a balanced
- * binary tree. We use a variation of it where nodes are reference counted to
- * keep an index of all strings belonging to an AST.
+ * Reference counters are updated atomically, so that zz_dict_ref() may be
+ * called without holding the lock that protects the dictionary, as long as
+ * the caller already owns a reference; everything else must be serialized.
+ *
+ * A dictionary may also work as a string pool, with all its strings allocated
+ * from an arena by zz_dict_intern(); those strings have a reference counter of
+ * zero, are never removed individually, and live until the arena is
+ * destroyed. The table of a pool comes from the allocator of its arena; other
+ * dictionaries use the default allocator.
  */
 
 /**
- * Reference-counted node in an AA tree
+ * Reference-counted string, as stored in the dictionary
  */
-struct zz_dict {
-	struct zz_dict *left, *right;
-	size_t level;
+struct zz_dict_entry {
+	size_t hash;
 	size_t ref_count;
-	char *data;
+	size_t length;
+	char data[];
+};
+
+/**
+ * Slot in the hash table; empty if ``entry`` is ``NULL``
+ */
+struct zz_dict_bucket {
+	size_t hash;
+	struct zz_dict_entry *entry;
+};
+
+/**
+ * Hash table; ``size`` is always a power of two
+ */
+struct zz_dict {
+	size_t size;
+	size_t count;
+	size_t bytes;
+	const struct zz_allocator *allocator;
+	struct zz_dict_bucket buckets[];
+};
+
+/**
+ * Statistics about one or more dictionaries
+ */
+struct zz_dict_stats {
+	/** Number of strings */
+	size_t count;
+	/** Total length of strings */
+	size_t bytes;
+	/** Approximate memory used by the tables and strings */
+	size_t memory;
+	/** Lookups that found the string already there */
+	size_t hits;
+	/** Lookups that had to add the string */
+	size_t misses;
+	/** Longest probe sequence, in buckets */
+	size_t max_depth;
 };
 
+/**
+ * Hash function used by the dictionary
+ */
+size_t zz_dict_hash(const char *data, size_t length);
+/**
+ * Get entry for a string returned by the dictionary
+ */
+static inline struct zz_dict_entry *zz_dict_entry(const char *data)
+{
+	return (struct zz_dict_entry *)(data - offsetof(struct zz_dict_entry, data));
+}
 /**
  * Look up string. Returns 1 if a string equal to ``data`` exists in the
  * dictionary and 0 otherwise; if it exists, the actual string is returned in
@@ -37,21 +103,96 @@ struct zz_dict {
  */
 int zz_dict_lookup(struct zz_dict *t, const char *data, const char **rval);
 /**
- * Insert string in tree. If ``data`` does not exist in the tree, a new node
- * will be created, and a copy of it will be stored in it, and passed back
- * through the ``rval`` pointer; if it already exists, its reference counter
- * will be incremented by one, and the original stringt will be returned
+ * Insert string in dictionary. If ``data`` does not exist in the dictionary, a
+ * new entry will be created, and a copy of it will be stored in it, and passed
+ * back through the ``rval`` pointer; if it already exists, its reference
+ * counter will be incremented by one, and the original string will be returned
  * through ``rval``.
  */
 struct zz_dict *zz_dict_insert(struct zz_dict *t, const char *data, const char **rval);
 /**
- * Delete string from tree. If ``data`` exists in the tree, its reference
- * counter will be decremented by one; if it reaches zero, the node holding it
- * will be removed.
+ * Delete string from dictionary. If ``data`` exists in the dictionary, its
+ * reference counter will be decremented by one; if it reaches zero, the entry
+ * holding it will be removed.
  */
 struct zz_dict *zz_dict_delete(struct zz_dict *t, const char *data);
 /**
- * Destroy the tree
+ * Insert the first ``length`` characters of ``data``, that need not be
+ * NUL-terminated; same as zz_dict_insert() otherwise.
+ */
+struct zz_dict *zz_dict_insert_n(struct zz_dict *t, const char *data,
+		size_t length, const char **rval);
+/**
+ * Insert string whose ``length`` and ``hash``, as computed by zz_dict_hash(),
+ * are already known; same as zz_dict_insert() otherwise.
+ */
+struct zz_dict *zz_dict_insert_hash(struct zz_dict *t, const char *data,
+		size_t length, size_t hash, const char **rval);
+/**
+ * Insert string in a pool. If ``data`` does not exist in the dictionary, a
+ * copy of it is allocated from ``arena`` and added to it; in any case, the
+ * pooled string is returned through ``rval``.
+ */
+struct zz_dict *zz_dict_intern(struct zz_dict *t, struct zz_arena *arena,
+		const char *data, const char **rval);
+/**
+ * Insert the first ``length`` characters of ``data`` in a pool; same as
+ * zz_dict_intern() otherwise.
+ */
+struct zz_dict *zz_dict_intern_n(struct zz_dict *t, struct zz_arena *arena,
+		const char *data, size_t length, const char **rval);
+/**
+ * Length of ``data``, that must have been returned by the dictionary
+ */
+static inline size_t zz_dict_length(const char *data)
+{
+	return zz_dict_entry(data)->length;
+}
+/**
+ * Return 1 if ``data``, that must have been returned by the dictionary,
+ * belongs to a pool, and 0 otherwise
+ */
+static inline int zz_dict_pooled(const char *data)
+{
+	return __atomic_load_n(&zz_dict_entry(data)->ref_count,
+			__ATOMIC_RELAXED) == 0;
+}
+/**
+ * Increment the reference counter of ``data``, that must have been returned
+ * by zz_dict_insert(); faster than inserting it again.
+ */
+static inline void zz_dict_ref(const char *data)
+{
+	if (!zz_dict_pooled(data))
+		__atomic_add_fetch(&zz_dict_entry(data)->ref_count, 1,
+				__ATOMIC_RELAXED);
+}
+/**
+ * Decrement the reference counter of ``data``, that must have been returned
+ * by zz_dict_insert(), and remove it if it reaches zero; faster than
+ * zz_dict_delete() because the string is identified by its address. Pooled
+ * strings are left alone.
+ */
+struct zz_dict *zz_dict_unref(struct zz_dict *t, const char *data);
+/**
+ * Add the number of strings, their length, memory used and depth of ``t`` to
+ * ``stats``; the depth requires walking the whole table. Hits and misses are
+ * not tracked by the dictionary.
+ */
+void zz_dict_stats(const struct zz_dict *t, struct zz_dict_stats *stats);
+/**
+ * Bytes taken by the table of ``t``, without the strings
+ */
+size_t zz_dict_table_size(const struct zz_dict *t);
+/**
+ * Remove all strings, but keep the table so that it doesn't have to grow again
+ * when refilled; this is the only way to get an empty dictionary that is not
+ * ``NULL``. Strings that belong to a pool are not released.
+ */
+void zz_dict_clear(struct zz_dict *t);
+/**
+ * Destroy the dictionary and all strings in it, except those that belong to a
+ * pool
  */
 void zz_dict_destroy(struct zz_dict *t);
 
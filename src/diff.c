@@ -0,0 +1,559 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#include "diff.h"
+#include "stack.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#define NONE ((size_t)-1)
+
+/* Hash of a node and number of entries of its subtree */
+struct hash_entry {
+	size_t hash;
+	size_t size;
+};
+
+/* Hashes of the nodes of a tree whose hashes are not known, in the order
+ * zz_hash_each() finds them, children before their parent */
+struct hash_list {
+	struct hash_entry *entries;
+	size_t count;
+	size_t alloc;
+	/* Sizes of the subtrees whose parent is yet to come */
+	struct zz_stack open;
+};
+
+/* Indices grouped by key, each group a list in increasing order linked
+ * through ``next``; a slot of the table is in use if its tail isn't NONE */
+struct groups {
+	size_t *keys;
+	size_t *heads;
+	size_t *tails;
+	size_t size;
+	size_t alloc;
+	size_t *next;
+	size_t next_alloc;
+};
+
+/* Deletion or insertion that may turn out to be a move */
+struct pending {
+	struct zz_edit edit;
+	size_t hash;
+};
+
+struct pending_list {
+	struct pending *items;
+	size_t count;
+	size_t alloc;
+};
+
+/* Children of one of the nodes being compared, with their hashes and their
+ * places in the hash list of their tree */
+struct children {
+	struct zz_node **nodes;
+	size_t *hashes;
+	size_t *positions;
+	size_t count;
+	size_t alloc;
+};
+
+struct state {
+	struct zz_diff *d;
+	struct hash_list from_list;
+	struct hash_list to_list;
+	struct groups groups;
+	/* Pairs of matched nodes, with their places in the hash lists, whose
+	 * children are still to be compared */
+	struct zz_stack pairs;
+	struct children from;
+	struct children to;
+	/* For old children, the key they are grouped by and whether they are
+	 * matched; for new ones, the index of their match or NONE */
+	size_t *keys;
+	unsigned char *matched;
+	size_t from_sized;
+	size_t *matches;
+	size_t *piles;
+	size_t *prev;
+	size_t to_sized;
+	struct pending_list deleted;
+	struct pending_list inserted;
+};
+
+static size_t mix(size_t x)
+{
+	x ^= x >> 31;
+	x *= 0x9e3779b97f4a7c15ULL;
+	return x ^ (x >> 29);
+}
+
+/* Grow array ``p`` of ``*alloc`` elements of ``size`` bytes to hold at least
+ * ``count`` */
+static void *grow(void *p, size_t *alloc, size_t count, size_t size)
+{
+	if (count <= *alloc)
+		return p;
+	while (*alloc < count)
+		*alloc = *alloc ? *alloc * 2 : 16;
+	return realloc(p, *alloc * size);
+}
+
+static void add_edit(struct zz_diff *d, enum zz_edit_type type,
+		struct zz_node *from, struct zz_node *to,
+		struct zz_node *parent, size_t index)
+{
+	struct zz_edit *e;
+
+	d->edits = grow(d->edits, &d->alloc, d->count + 1, sizeof(*d->edits));
+	e = &d->edits[d->count++];
+	e->type = type;
+	e->from = from;
+	e->to = to;
+	e->parent = parent;
+	e->index = index;
+}
+
+static void add_pending(struct pending_list *l, enum zz_edit_type type,
+		struct zz_node *from, struct zz_node *to,
+		struct zz_node *parent, size_t index, size_t hash)
+{
+	struct pending *p;
+
+	l->items = grow(l->items, &l->alloc, l->count + 1, sizeof(*l->items));
+	p = &l->items[l->count++];
+	p->edit.type = type;
+	p->edit.from = from;
+	p->edit.to = to;
+	p->edit.parent = parent;
+	p->edit.index = index;
+	p->hash = hash;
+}
+
+static int hashes_known(struct zz_node *n)
+{
+	return zz_is_shared(n) || n->tree->flags & ZZ_TREE_HASHES;
+}
+
+static void list_add(struct zz_node *n, size_t hash, void *data)
+{
+	struct hash_list *l = data;
+	struct hash_entry *e;
+	struct zz_node *c;
+	size_t size = 1;
+
+	/* Nodes with a known hash come without their children */
+	if (!hashes_known(n)) {
+		zz_foreach_child(c, n)
+			size += (uintptr_t)zz_stack_pop(&l->open);
+	}
+	l->entries = grow(l->entries, &l->alloc, l->count + 1,
+			sizeof(*l->entries));
+	e = &l->entries[l->count++];
+	e->hash = hash;
+	e->size = size;
+	zz_stack_push(&l->open, (void *)(uintptr_t)size);
+}
+
+/* Hash the tree of ``n``, and return its place in the list, or NONE if the
+ * hashes of the tree are known */
+static size_t list_build(struct hash_list *l, struct zz_node *n)
+{
+	if (hashes_known(n)) {
+		zz_hash(n);
+		return NONE;
+	}
+	zz_stack_init(&l->open);
+	zz_hash_each(n, list_add, l);
+	zz_stack_destroy(&l->open);
+	return l->count - 1;
+}
+
+static size_t list_hash(struct hash_list *l, struct zz_node *n, size_t pos)
+{
+	return pos == NONE ? zz_hash(n) : l->entries[pos].hash;
+}
+
+/* Get the children of ``n``, found at ``pos`` in ``l`` */
+static void get_children(struct children *c, struct hash_list *l,
+		struct zz_node *n, size_t pos)
+{
+	struct zz_node *i;
+	size_t k, p = pos;
+
+	c->count = 0;
+	zz_foreach_child(i, n) {
+		if (c->count == c->alloc) {
+			c->nodes = grow(c->nodes, &c->alloc, c->count + 1,
+					sizeof(*c->nodes));
+			c->hashes = realloc(c->hashes,
+					c->alloc * sizeof(*c->hashes));
+			c->positions = realloc(c->positions,
+					c->alloc * sizeof(*c->positions));
+		}
+		c->nodes[c->count++] = i;
+	}
+	/* The last child is right before its parent, and each of the others
+	 * right before the subtree of the next one */
+	for (k = c->count; k-- > 0; ) {
+		if (pos != NONE)
+			p = k + 1 == c->count ? pos - 1 : p - l->entries[p].size;
+		if (pos == NONE || hashes_known(c->nodes[k])) {
+			c->positions[k] = NONE;
+			c->hashes[k] = zz_hash(c->nodes[k]);
+		} else {
+			c->positions[k] = p;
+			c->hashes[k] = l->entries[p].hash;
+		}
+	}
+}
+
+static void children_destroy(struct children *c)
+{
+	free(c->nodes);
+	free(c->hashes);
+	free(c->positions);
+}
+
+/* Group indices from ``begin`` to ``end`` by ``keys``, leaving out those
+ * that are ``matched`` */
+static void groups_build(struct groups *g, const size_t *keys,
+		const unsigned char *matched, size_t begin, size_t end)
+{
+	size_t size, mask, i, j;
+
+	for (size = 16; size < (end - begin) * 2; size *= 2)
+		continue;
+	if (size > g->alloc) {
+		g->alloc = size;
+		g->keys = realloc(g->keys, size * sizeof(*g->keys));
+		g->heads = realloc(g->heads, size * sizeof(*g->heads));
+		g->tails = realloc(g->tails, size * sizeof(*g->tails));
+	}
+	g->size = size;
+	memset(g->tails, 0xff, size * sizeof(*g->tails));
+	g->next = grow(g->next, &g->next_alloc, end, sizeof(*g->next));
+	mask = size - 1;
+	for (i = begin; i < end; ++i) {
+		if (matched[i])
+			continue;
+		for (j = mix(keys[i]) & mask; g->tails[j] != NONE &&
+				g->keys[j] != keys[i]; j = (j + 1) & mask)
+			continue;
+		if (g->tails[j] == NONE) {
+			g->keys[j] = keys[i];
+			g->heads[j] = i;
+		} else {
+			g->next[g->tails[j]] = i;
+		}
+		g->tails[j] = i;
+		g->next[i] = NONE;
+	}
+}
+
+/* Slot of the group of ``key``, or NONE if there is none */
+static size_t groups_find(const struct groups *g, size_t key)
+{
+	size_t mask = g->size - 1, j;
+
+	for (j = mix(key) & mask; g->tails[j] != NONE; j = (j + 1) & mask) {
+		if (g->keys[j] == key)
+			return j;
+	}
+	return NONE;
+}
+
+/* Take the first index of the group of ``key``, or NONE if it is empty */
+static size_t groups_pop(struct groups *g, size_t key)
+{
+	size_t i, j;
+
+	j = groups_find(g, key);
+	if (j == NONE)
+		return NONE;
+	i = g->heads[j];
+	if (i != NONE)
+		g->heads[j] = g->next[i];
+	return i;
+}
+
+/* Take the first index ``i`` of the group of ``key`` such that ``nodes[i]``
+ * is equal to ``n``, or NONE if there is none; indices whose nodes only
+ * share the key stay in the group */
+static size_t groups_pop_equal(struct groups *g, size_t key,
+		struct zz_node *const *nodes, struct zz_node *n)
+{
+	size_t i, j, prev;
+
+	j = groups_find(g, key);
+	if (j == NONE)
+		return NONE;
+	for (prev = NONE, i = g->heads[j]; i != NONE; prev = i, i = g->next[i]) {
+		if (!zz_equal(nodes[i], n))
+			continue;
+		if (prev == NONE)
+			g->heads[j] = g->next[i];
+		else
+			g->next[prev] = g->next[i];
+		return i;
+	}
+	return NONE;
+}
+
+static void groups_destroy(struct groups *g)
+{
+	free(g->keys);
+	free(g->heads);
+	free(g->tails);
+	free(g->next);
+}
+
+/* Match new child ``j`` with old child ``i``, to be compared in turn */
+static void match(struct state *st, size_t i, size_t j)
+{
+	st->matches[j] = i;
+	st->matched[i] = 1;
+	zz_stack_push(&st->pairs, st->from.nodes[i]);
+	zz_stack_push(&st->pairs, (void *)(uintptr_t)st->from.positions[i]);
+	zz_stack_push(&st->pairs, st->to.nodes[j]);
+	zz_stack_push(&st->pairs, (void *)(uintptr_t)st->to.positions[j]);
+}
+
+/* Mark as moves the matched children of the new node that are not in the
+ * longest run whose matches keep their order */
+static void find_moves(struct state *st, struct zz_node *to, size_t begin,
+		size_t end)
+{
+	size_t count = 0, lo, hi, mid, j, k;
+
+	/* Patience sorting; ``piles[k]`` is the child that ends the best run
+	 * of length k + 1 found so far */
+	for (j = begin; j < end; ++j) {
+		if (st->matches[j] == NONE)
+			continue;
+		lo = 0;
+		hi = count;
+		while (lo < hi) {
+			mid = (lo + hi) / 2;
+			if (st->matches[st->piles[mid]] < st->matches[j])
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		st->prev[j] = lo > 0 ? st->piles[lo - 1] : NONE;
+		st->piles[lo] = j;
+		if (lo == count)
+			++count;
+	}
+	/* Children in the run point to themselves, the rest are moves */
+	for (j = count ? st->piles[count - 1] : NONE; j != NONE; j = k) {
+		k = st->prev[j];
+		st->prev[j] = j;
+	}
+	for (j = begin; j < end; ++j) {
+		if (st->matches[j] != NONE && st->prev[j] != j)
+			add_edit(st->d, ZZ_EDIT_MOVE,
+					st->from.nodes[st->matches[j]],
+					st->to.nodes[j], to, j);
+	}
+}
+
+/* Return 1 if subtrees ``a`` and ``b``, with hashes ``ha`` and ``hb``, are
+ * equal; equal hashes are only a hint, since hashes can be made to collide,
+ * so they are confirmed by comparing the subtrees */
+static int same(struct zz_node *a, size_t ha, struct zz_node *b, size_t hb)
+{
+	return ha == hb && zz_equal(a, b);
+}
+
+/* Match the children of two nodes that differ */
+static void compare_children(struct state *st, struct zz_node *from,
+		size_t from_pos, struct zz_node *to, size_t to_pos)
+{
+	struct children *fc = &st->from, *tc = &st->to;
+	size_t begin, end_from, end_to, i, j;
+
+	get_children(fc, &st->from_list, from, from_pos);
+	get_children(tc, &st->to_list, to, to_pos);
+	if (st->from_sized < fc->alloc) {
+		st->from_sized = fc->alloc;
+		st->keys = realloc(st->keys, st->from_sized * sizeof(*st->keys));
+		st->matched = realloc(st->matched, st->from_sized);
+	}
+	if (st->to_sized < tc->alloc) {
+		st->to_sized = tc->alloc;
+		st->matches = realloc(st->matches,
+				st->to_sized * sizeof(*st->matches));
+		st->piles = realloc(st->piles, st->to_sized * sizeof(*st->piles));
+		st->prev = realloc(st->prev, st->to_sized * sizeof(*st->prev));
+	}
+	if (fc->count > 0)
+		memset(st->matched, 0, fc->count);
+
+	/* Children left untouched at both ends */
+	for (begin = 0; begin < fc->count && begin < tc->count &&
+			same(fc->nodes[begin], fc->hashes[begin],
+				tc->nodes[begin], tc->hashes[begin]); ++begin)
+		continue;
+	for (end_from = fc->count, end_to = tc->count;
+			end_from > begin && end_to > begin &&
+			same(fc->nodes[end_from - 1], fc->hashes[end_from - 1],
+				tc->nodes[end_to - 1], tc->hashes[end_to - 1]);
+			--end_from, --end_to)
+		continue;
+
+	/* Equal subtrees among the rest */
+	groups_build(&st->groups, fc->hashes, st->matched, begin, end_from);
+	for (j = begin; j < end_to; ++j) {
+		i = groups_pop_equal(&st->groups, tc->hashes[j], fc->nodes,
+				tc->nodes[j]);
+		st->matches[j] = i;
+		if (i != NONE)
+			st->matched[i] = 1;
+	}
+
+	/* Then nodes in the place of the old ones, if they have the same
+	 * token */
+	for (j = begin; j < end_to; ++j) {
+		if (st->matches[j] != NONE)
+			continue;
+		if (j == begin)
+			i = begin;
+		else if (st->matches[j - 1] != NONE)
+			i = st->matches[j - 1] + 1;
+		else
+			continue;
+		if (i < end_from && !st->matched[i] &&
+				fc->nodes[i]->token == tc->nodes[j]->token)
+			match(st, i, j);
+	}
+
+	/* And anywhere else */
+	for (i = begin; i < end_from; ++i)
+		st->keys[i] = (uintptr_t)fc->nodes[i]->token;
+	groups_build(&st->groups, st->keys, st->matched, begin, end_from);
+	for (j = begin; j < end_to; ++j) {
+		if (st->matches[j] != NONE)
+			continue;
+		i = groups_pop(&st->groups, (uintptr_t)tc->nodes[j]->token);
+		if (i != NONE)
+			match(st, i, j);
+		else
+			add_pending(&st->inserted, ZZ_EDIT_INSERT, NULL,
+					tc->nodes[j], to, j, tc->hashes[j]);
+	}
+	for (i = begin; i < end_from; ++i) {
+		if (!st->matched[i])
+			add_pending(&st->deleted, ZZ_EDIT_DELETE, fc->nodes[i],
+					NULL, NULL, 0, fc->hashes[i]);
+	}
+	find_moves(st, to, begin, end_to);
+}
+
+/* Turn insertions of subtrees equal to deleted ones into moves, and add the
+ * rest of both to the edits */
+static void flush_pending(struct state *st)
+{
+	struct zz_edit *e;
+	struct zz_node **from;
+	size_t *keys, i, j;
+	unsigned char *moved;
+
+	keys = malloc((st->deleted.count + 1) * sizeof(*keys));
+	from = malloc((st->deleted.count + 1) * sizeof(*from));
+	moved = calloc(st->deleted.count + 1, 1);
+	for (i = 0; i < st->deleted.count; ++i) {
+		keys[i] = st->deleted.items[i].hash;
+		from[i] = st->deleted.items[i].edit.from;
+	}
+	groups_build(&st->groups, keys, moved, 0, st->deleted.count);
+	for (j = 0; j < st->inserted.count; ++j) {
+		e = &st->inserted.items[j].edit;
+		i = groups_pop_equal(&st->groups, st->inserted.items[j].hash,
+				from, e->to);
+		if (i == NONE)
+			continue;
+		moved[i] = 1;
+		e->type = ZZ_EDIT_MOVE;
+		e->from = st->deleted.items[i].edit.from;
+		add_edit(st->d, e->type, e->from, e->to, e->parent, e->index);
+	}
+	for (i = 0; i < st->deleted.count; ++i) {
+		if (!moved[i])
+			add_edit(st->d, ZZ_EDIT_DELETE,
+					st->deleted.items[i].edit.from,
+					NULL, NULL, 0);
+	}
+	for (j = 0; j < st->inserted.count; ++j) {
+		e = &st->inserted.items[j].edit;
+		if (e->type == ZZ_EDIT_INSERT)
+			add_edit(st->d, e->type, NULL, e->to, e->parent, e->index);
+	}
+	free(keys);
+	free(from);
+	free(moved);
+}
+
+void zz_diff_init(struct zz_diff *d)
+{
+	d->edits = NULL;
+	d->count = 0;
+	d->alloc = 0;
+}
+
+void zz_diff_destroy(struct zz_diff *d)
+{
+	free(d->edits);
+	zz_diff_init(d);
+}
+
+size_t zz_diff(struct zz_diff *d, struct zz_node *from, struct zz_node *to)
+{
+	struct state st;
+	size_t from_pos, to_pos;
+
+	memset(&st, 0, sizeof(st));
+	st.d = d;
+	d->count = 0;
+	zz_stack_init(&st.pairs);
+	from_pos = list_build(&st.from_list, from);
+	to_pos = list_build(&st.to_list, to);
+
+	if (from->token != to->token) {
+		add_edit(d, ZZ_EDIT_DELETE, from, NULL, NULL, 0);
+		add_edit(d, ZZ_EDIT_INSERT, NULL, to, NULL, 0);
+	} else {
+		zz_stack_push(&st.pairs, from);
+		zz_stack_push(&st.pairs, (void *)(uintptr_t)from_pos);
+		zz_stack_push(&st.pairs, to);
+		zz_stack_push(&st.pairs, (void *)(uintptr_t)to_pos);
+	}
+	while (!zz_stack_empty(&st.pairs)) {
+		to_pos = (uintptr_t)zz_stack_pop(&st.pairs);
+		to = zz_stack_pop(&st.pairs);
+		from_pos = (uintptr_t)zz_stack_pop(&st.pairs);
+		from = zz_stack_pop(&st.pairs);
+		if (same(from, list_hash(&st.from_list, from, from_pos),
+					to, list_hash(&st.to_list, to, to_pos)))
+			continue;
+		if (!zz_data_equal(from->data, to->data))
+			add_edit(d, ZZ_EDIT_UPDATE, from, to, NULL, 0);
+		compare_children(&st, from, from_pos, to, to_pos);
+	}
+	flush_pending(&st);
+
+	zz_stack_destroy(&st.pairs);
+	free(st.from_list.entries);
+	free(st.to_list.entries);
+	groups_destroy(&st.groups);
+	children_destroy(&st.from);
+	children_destroy(&st.to);
+	free(st.keys);
+	free(st.matched);
+	free(st.matches);
+	free(st.piles);
+	free(st.prev);
+	free(st.deleted.items);
+	free(st.inserted.items);
+	return d->count;
+}
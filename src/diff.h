@@ -0,0 +1,92 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#ifndef ZEBU_DIFF_H_
+#define ZEBU_DIFF_H_
+
+#include "tree.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Diff
+ * ----
+ *
+ * Edits that turn one tree into another, such as two parses of the same file.
+ *
+ * Both trees are walked from the roots down in step. Subtrees with the same
+ * hash (see zz_hash()) are confirmed to be equal with zz_equal(), since
+ * hashes can collide, and are then not entered. The children of two nodes
+ * that differ are matched first by hash, which finds the subtrees left
+ * untouched, then by place and by token; matched children that differ are
+ * compared the same way. Children left without a match are deleted from the
+ * old tree or inserted in the new one, except that an inserted subtree equal
+ * to a deleted one is a move.
+ *
+ * The cost is proportional to the number of children of the nodes that
+ * differ, plus one pass over each tree to hash it when its hashes are not
+ * known, plus the walk that confirms each unchanged subtree. Trees created
+ * with ``ZZ_TREE_HASHES`` or ``ZZ_TREE_SHARED`` skip the first pass, and
+ * versions of the same shared tree skip the walks too, since their unchanged
+ * subtrees are the same node. Every node of a tree must come from the same
+ * ``zz_tree`` as its root.
+ */
+
+/**
+ * Kind of edit
+ */
+enum zz_edit_type {
+	/** Subtree ``to`` is added, as child ``index`` of ``parent`` */
+	ZZ_EDIT_INSERT,
+	/** Subtree ``from`` is removed */
+	ZZ_EDIT_DELETE,
+	/** Node ``from`` gets the data of ``to``; their children are edited
+	 * separately */
+	ZZ_EDIT_UPDATE,
+	/** Subtree ``from``, equal to ``to`` or edited separately into it,
+	 * becomes child ``index`` of ``parent`` */
+	ZZ_EDIT_MOVE,
+};
+
+/**
+ * Edit; ``from`` is a node of the old tree and ``to`` one of the new tree,
+ * as are ``parent`` and ``index``, the place of ``to`` in the new tree
+ */
+struct zz_edit {
+	enum zz_edit_type type;
+	struct zz_node *from;
+	struct zz_node *to;
+	struct zz_node *parent;
+	size_t index;
+};
+
+/**
+ * List of edits
+ */
+struct zz_diff {
+	struct zz_edit *edits;
+	size_t count;
+	size_t alloc;
+};
+
+/**
+ * Initialize empty list of edits
+ */
+void zz_diff_init(struct zz_diff *d);
+/**
+ * Destroy list of edits
+ */
+void zz_diff_destroy(struct zz_diff *d);
+/**
+ * Replace the edits of ``d`` with those that turn the tree of ``from`` into
+ * that of ``to``, and return their number; updates and moves come first, in
+ * the order the trees are walked, then deletions and insertions
+ */
+size_t zz_diff(struct zz_diff *d, struct zz_node *from, struct zz_node *to);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif       // ZEBU_DIFF_H_
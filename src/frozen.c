@@ -0,0 +1,108 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#include "frozen.h"
+
+#include <string.h>
+
+#include "stack.h"
+
+#define RECORD(f, k) ((struct zz_frozen_node *)((f)->nodes + (k) * (f)->stride))
+
+void zz_tree_freeze(struct zz_node *node, struct zz_frozen *f)
+{
+	struct zz_frozen_node *r;
+	struct zz_stack stack;
+	struct zz_node *iter;
+	size_t base, alloc, k, c, end, i;
+	void *tmp;
+
+	base = zz_node_base_size(node->tree);
+	f->ext_size = node->tree->node_size - base;
+	f->stride = zz_arena_align(sizeof(*r) + f->ext_size);
+	f->nodes = NULL;
+	f->count = alloc = 0;
+
+	/* Write records in preorder; ``size`` holds the number of children
+	 * until the records of all of them are written */
+	zz_stack_init(&stack);
+	zz_stack_push(&stack, node);
+	while (!zz_stack_empty(&stack)) {
+		node = zz_stack_pop(&stack);
+		if (f->count == alloc) {
+			alloc = alloc ? alloc * 2 : 256;
+			f->nodes = realloc(f->nodes, alloc * f->stride);
+		}
+		r = RECORD(f, f->count++);
+		r->token = node->token;
+		/* Strings from a pool are moved to the global dictionary, so
+		 * that they outlive the tree */
+		if (node->data.type == ZZ_STRING &&
+				!zz_string_is_inline(node->data) &&
+				zz_dict_pooled(node->data.data.string_val))
+			r->data = zz_string_n(node->data.data.string_val,
+					zz_string_length(node->data));
+		else
+			r->data = zz_data_copy(node->data);
+		r->next = 0;
+		r->size = 0;
+		memcpy(r + 1, (char *)node + base, f->ext_size);
+		/* Children are pushed in order and then reversed, because
+		 * iterating backwards is slow on compact trees */
+		zz_foreach_child(iter, node) {
+			zz_stack_push(&stack, iter);
+			++r->size;
+		}
+		for (i = 0; i < r->size / 2; ++i) {
+			tmp = stack.data[stack.size - 1 - i];
+			stack.data[stack.size - 1 - i] =
+				stack.data[stack.size - r->size + i];
+			stack.data[stack.size - r->size + i] = tmp;
+		}
+	}
+	zz_stack_destroy(&stack);
+	f->nodes = realloc(f->nodes, f->count * f->stride);
+
+	/* Children of each node follow those of the previous one */
+	f->parents = malloc(3 * f->count * sizeof(*f->parents));
+	f->child_offsets = f->parents + f->count;
+	f->children = f->child_offsets + f->count + 1;
+	f->parents[0] = 0;
+	c = 0;
+	for (k = 0; k < f->count; ++k) {
+		f->child_offsets[k] = c;
+		c += RECORD(f, k)->size;
+	}
+	f->child_offsets[f->count] = c;
+
+	/* Subtrees of children are complete before their parent's */
+	for (k = f->count; k-- > 0; ) {
+		r = RECORD(f, k);
+		c = k + 1;
+		for (i = 0; i < r->size; ++i)
+			c += RECORD(f, c)->size;
+		r->size = c - k;
+	}
+	for (k = 0; k < f->count; ++k) {
+		end = k + RECORD(f, k)->size;
+		i = f->child_offsets[k];
+		for (c = k + 1; c < end; c += RECORD(f, c)->size) {
+			RECORD(f, c)->next = c + RECORD(f, c)->size < end ?
+				c + RECORD(f, c)->size : 0;
+			f->parents[c] = k;
+			f->children[i++] = c;
+		}
+	}
+}
+
+void zz_frozen_destroy(struct zz_frozen *f)
+{
+	size_t k;
+
+	for (k = 0; k < f->count; ++k)
+		zz_data_destroy(RECORD(f, k)->data);
+	free(f->nodes);
+	free(f->parents);
+	f->nodes = NULL;
+	f->parents = NULL;
+	f->count = 0;
+}
@@ -0,0 +1,178 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#ifndef ZEBU_FROZEN_H_
+#define ZEBU_FROZEN_H_
+
+#include <stdint.h>
+
+#include "tree.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Frozen trees
+ * ------------
+ *
+ * Read-only copy of a tree in a single buffer, with its nodes in preorder.
+ *
+ * The first child of a node, if any, is the record that follows it, and each
+ * record knows the size of its subtree and where its next sibling is, so that
+ * walking the whole tree, or any subtree, is a linear scan of memory. User
+ * extension bytes are copied right after each record. Parents and children by
+ * index are found in constant time through tables kept apart from the
+ * records.
+ *
+ * A frozen tree holds its own reference to every string payload, taken from
+ * the global dictionary even for strings of a string pool, and is independent
+ * of the tree it was made from.
+ */
+
+/**
+ * Node of a frozen tree
+ */
+struct zz_frozen_node {
+	const char *token;
+	struct zz_data data;
+	/** Index of the next sibling, or 0 if there isn't one */
+	uint32_t next;
+	/** Number of nodes in the subtree, including this one */
+	uint32_t size;
+};
+
+/**
+ * Frozen tree
+ */
+struct zz_frozen {
+	char *nodes;
+	size_t count;
+	size_t stride;
+	size_t ext_size;
+	/** Index of the parent of each node */
+	uint32_t *parents;
+	/** Indices of the children of node ``i`` are in ``children``, from
+	 * ``child_offsets[i]`` to ``child_offsets[i + 1]`` */
+	uint32_t *child_offsets;
+	uint32_t *children;
+};
+
+/**
+ * Freeze the tree whose root is ``node`` into ``f``
+ */
+void zz_tree_freeze(struct zz_node *node, struct zz_frozen *f);
+/**
+ * Destroy frozen tree
+ */
+void zz_frozen_destroy(struct zz_frozen *f);
+
+/**
+ * Number of nodes
+ */
+static inline size_t zz_frozen_count(const struct zz_frozen *f)
+{
+	return f->count;
+}
+/**
+ * Get node at index ``i`` in preorder, and index of node
+ */
+static inline const struct zz_frozen_node *zz_frozen_at(const struct zz_frozen *f, size_t i)
+{
+	return (const struct zz_frozen_node *)(f->nodes + i * f->stride);
+}
+static inline size_t zz_frozen_index(const struct zz_frozen *f,
+		const struct zz_frozen_node *n)
+{
+	return ((const char *)n - f->nodes) / f->stride;
+}
+/**
+ * Get root node
+ */
+static inline const struct zz_frozen_node *zz_frozen_root(const struct zz_frozen *f)
+{
+	return zz_frozen_at(f, 0);
+}
+/**
+ * Get first child and next sibling of node, or ``NULL`` if there isn't one
+ */
+static inline const struct zz_frozen_node *zz_frozen_first_child(
+		const struct zz_frozen *f, const struct zz_frozen_node *n)
+{
+	if (n->size == 1)
+		return NULL;
+	return (const struct zz_frozen_node *)((const char *)n + f->stride);
+}
+static inline const struct zz_frozen_node *zz_frozen_next_sibling(
+		const struct zz_frozen *f, const struct zz_frozen_node *n)
+{
+	if (n->next == 0)
+		return NULL;
+	return zz_frozen_at(f, n->next);
+}
+/**
+ * Get parent of node, or ``NULL`` for the root
+ */
+static inline const struct zz_frozen_node *zz_frozen_parent(
+		const struct zz_frozen *f, const struct zz_frozen_node *n)
+{
+	size_t i = zz_frozen_index(f, n);
+	if (i == 0)
+		return NULL;
+	return zz_frozen_at(f, f->parents[i]);
+}
+/**
+ * Number of children of node
+ */
+static inline size_t zz_frozen_child_count(const struct zz_frozen *f,
+		const struct zz_frozen_node *n)
+{
+	size_t i = zz_frozen_index(f, n);
+	return f->child_offsets[i + 1] - f->child_offsets[i];
+}
+/**
+ * Get child of node at ``index``, or ``NULL`` if there isn't one
+ */
+static inline const struct zz_frozen_node *zz_frozen_child(
+		const struct zz_frozen *f, const struct zz_frozen_node *n,
+		size_t index)
+{
+	size_t i = zz_frozen_index(f, n);
+	if (index >= f->child_offsets[i + 1] - f->child_offsets[i])
+		return NULL;
+	return zz_frozen_at(f, f->children[f->child_offsets[i] + index]);
+}
+/**
+ * Get the node that follows the subtree of node in preorder, which is past
+ * the end of the buffer for the root
+ */
+static inline const struct zz_frozen_node *zz_frozen_end(
+		const struct zz_frozen *f, const struct zz_frozen_node *n)
+{
+	return (const struct zz_frozen_node *)((const char *)n +
+			n->size * f->stride);
+}
+/**
+ * Get the user extension bytes of node
+ */
+static inline const void *zz_frozen_ext(const struct zz_frozen_node *n)
+{
+	return n + 1;
+}
+/**
+ * Iterate on children of node
+ */
+#define zz_frozen_foreach_child(iter, f, n) \
+for (iter = zz_frozen_first_child(f, n); iter != NULL; \
+		iter = zz_frozen_next_sibling(f, iter))
+/**
+ * Iterate on node and all its descendants in preorder
+ */
+#define zz_frozen_foreach(iter, f, n) \
+for (iter = (n); iter < zz_frozen_end(f, n); \
+		iter = (const struct zz_frozen_node *)((const char *)iter + (f)->stride))
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif       // ZEBU_FROZEN_H_
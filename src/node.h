@@ -5,11 +5,15 @@
 
 #include "list.h"
 #include "data.h"
+#include "tree.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+struct zz_data zz_tree_string(struct zz_tree *tree, const char *str);
+struct zz_data zz_tree_string_n(struct zz_tree *tree, const char *str, size_t length);
+
 /**
  * Node
  * ----
@@ -24,37 +28,194 @@ extern "C" {
  * Node in an AST
  */
 struct zz_node {
+	const char *token;
+	struct zz_data data;
+	struct zz_tree *tree;
 	struct zz_list siblings;
 	struct zz_list children;
 	struct zz_list allocated;
+};
+/**
+ * Node in a tree created with ``ZZ_TREE_COMPACT``
+ *
+ * Shares its first fields with ``zz_node`` and is always handled through a
+ * pointer to one, but the fields that follow are different. Children form a
+ * singly-linked list, and their parent points to both ends of it. Nodes with
+ * user extensions must embed this instead of ``zz_node``.
+ *
+ * Getting the previous sibling, and therefore iterating backwards, takes
+ * linear time, and without parent links nodes can only be unlinked with
+ * zz_remove_child().
+ */
+struct zz_compact_node {
 	const char *token;
 	struct zz_data data;
+	struct zz_tree *tree;
+	struct zz_node *first_child;
+	struct zz_node *last_child;
+	struct zz_node *next_sibling;
 };
 
+#define ZZ_COMPACT(n) ((struct zz_compact_node *)(n))
+
 /**
- * Iterate on children list, forward and backwards; the safe functions tike an
- * additional argument that is used as temporary storage and allows unlinking
- * the iterator inside the loop.
+ * Node in a tree created with ``ZZ_TREE_SHARED``
+ *
+ * Shares its first fields with ``zz_node`` like ``zz_compact_node``. Children
+ * are an array of pointers, so a node may be the child of several parents, or
+ * more than once of the same one. Nodes are created by zz_node_shared() with
+ * all their children, and never change. ``refs`` counts the references to
+ * the node, held by its parents and by the callers that got it (see
+ * zz_unref()).
  */
-#define zz_foreach_child(iter, node) \
-zz_list_foreach_entry(iter, &node->children, siblings)
-#define zz_reverse_foreach_child(iter, node) \
-zz_list_reverse_foreach_entry(iter, &node->children, siblings)
-#define zz_foreach_child_safe(iter, temp, node) \
-zz_list_foreach_entry_safe(iter, temp, &node->children, siblings)
-#define zz_reverse_foreach_child_safe(iter, temp, node) \
-zz_list_reverse_foreach_entry_safe(iter, temp, &node->children, siblings)
+struct zz_shared_node {
+	const char *token;
+	struct zz_data data;
+	struct zz_tree *tree;
+	struct zz_node **children;
+	size_t child_count;
+	size_t hash;
+	size_t refs;
+};
+
+#define ZZ_SHARED(n) ((struct zz_shared_node *)(n))
+
+/**
+ * Links kept in front of the nodes of a tree created with ``ZZ_TREE_PARENTS``
+ */
+struct zz_node_links {
+	struct zz_node *parent;
+	size_t child_count;
+	/** Child last returned by zz_child(), and its index */
+	struct zz_node *cursor;
+	size_t cursor_index;
+};
+
+/**
+ * Return 1 if ``n`` has the compact layout, and 0 otherwise
+ */
+static inline int zz_is_compact(const struct zz_node *n)
+{
+	return (n->tree->flags & ZZ_TREE_COMPACT) != 0;
+}
+/**
+ * Return 1 if ``n`` has the shared layout, and 0 otherwise
+ */
+static inline int zz_is_shared(const struct zz_node *n)
+{
+	return (n->tree->flags & ZZ_TREE_SHARED) != 0;
+}
+/**
+ * Size of the nodes of ``tree`` before user extensions
+ */
+static inline size_t zz_node_base_size(const struct zz_tree *tree)
+{
+	if (tree->flags & ZZ_TREE_COMPACT)
+		return sizeof(struct zz_compact_node);
+	if (tree->flags & ZZ_TREE_SHARED)
+		return sizeof(struct zz_shared_node);
+	return sizeof(struct zz_node);
+}
+/**
+ * Return 1 if ``n`` has parent links, and 0 otherwise
+ */
+static inline int zz_has_parents(const struct zz_node *n)
+{
+	return (n->tree->flags & ZZ_TREE_PARENTS) != 0;
+}
+/**
+ * Size of the memory in front of the nodes of ``tree``
+ */
+static inline size_t zz_node_prefix_size(const struct zz_tree *tree)
+{
+	size_t size = 0;
+	if (tree->flags & ZZ_TREE_PARENTS)
+		size += zz_arena_align(sizeof(struct zz_node_links));
+	if (tree->flags & ZZ_TREE_HASHES)
+		size += zz_arena_align(sizeof(size_t));
+	if (tree->flags & ZZ_TREE_TOKEN_INDEX)
+		size += zz_arena_align(sizeof(struct zz_list));
+	return size;
+}
+/**
+ * Get the links of a node with parent links
+ */
+static inline struct zz_node_links *zz_links(const struct zz_node *n)
+{
+	return (struct zz_node_links *)((char *)n -
+			zz_arena_align(sizeof(struct zz_node_links)));
+}
 /**
- * Get next and previous sibling of node, or ``NULL`` if there isn't one
+ * Get the cached hash of a node of a tree created with ``ZZ_TREE_HASHES``, in
+ * front of its links; 0 if it has not been computed since the node or its
+ * descendants last changed
+ */
+static inline size_t *zz_cached_hash(const struct zz_node *n)
+{
+	return (size_t *)((char *)n - zz_arena_align(sizeof(struct zz_node_links)) -
+			zz_arena_align(sizeof(size_t)));
+}
+/**
+ * Forget the cached hash of node and its ancestors; called by the functions
+ * that change a node, which must not be shared
+ */
+static inline void zz_invalidate_hash(struct zz_node *n)
+{
+	assert(!zz_is_shared(n));
+	if (!(n->tree->flags & ZZ_TREE_HASHES))
+		return;
+	/* Ancestors of a node without a hash don't have one either */
+	while (n != NULL && *zz_cached_hash(n) != 0) {
+		*zz_cached_hash(n) = 0;
+		n = zz_links(n)->parent;
+	}
+}
+/**
+ * Get the entry of a node in the token index of its tree, in front of its
+ * links and cached hash if it has them
+ */
+static inline struct zz_list *zz_token_link(const struct zz_node *n)
+{
+	return (struct zz_list *)((char *)n - zz_node_prefix_size(n->tree));
+}
+/**
+ * Get next and previous sibling of node, or ``NULL`` if there isn't one. For
+ * shared nodes, ``c`` is searched for among the children of ``p``, and the
+ * first time it appears is taken; the iteration macros keep track of
+ * positions instead.
  */
 static inline struct zz_node *zz_next_sibling(struct zz_node *p, struct zz_node *c)
 {
+	size_t i;
+	if (zz_is_compact(p))
+		return ZZ_COMPACT(c)->next_sibling;
+	if (zz_is_shared(p)) {
+		for (i = 0; ZZ_SHARED(p)->children[i] != c; ++i)
+			continue;
+		return i + 1 < ZZ_SHARED(p)->child_count ?
+			ZZ_SHARED(p)->children[i + 1] : NULL;
+	}
 	if (c->siblings.next == &p->children)
 		return NULL;
 	return zz_list_entry(c->siblings.next, struct zz_node, siblings);
 }
 static inline struct zz_node *zz_prev_sibling(struct zz_node *p, struct zz_node *c)
 {
+	struct zz_node *i;
+	size_t k;
+	if (zz_is_compact(p)) {
+		i = ZZ_COMPACT(p)->first_child;
+		if (i == c)
+			return NULL;
+		while (ZZ_COMPACT(i)->next_sibling != c)
+			i = ZZ_COMPACT(i)->next_sibling;
+		return i;
+	}
+	if (zz_is_shared(p)) {
+		for (k = 0; ZZ_SHARED(p)->children[k] != c; ++k)
+			continue;
+		return k > 0 ? ZZ_SHARED(p)->children[k - 1] : NULL;
+	}
 	if (c->siblings.prev == &p->children)
 		return NULL;
 	return zz_list_entry(c->siblings.prev, struct zz_node, siblings);
@@ -64,46 +225,208 @@ static inline struct zz_node *zz_prev_sibling(struct zz_node *p, struct zz_node
  */
 static inline struct zz_node *zz_first_child(struct zz_node *n)
 {
+	if (zz_is_compact(n))
+		return ZZ_COMPACT(n)->first_child;
+	if (zz_is_shared(n))
+		return ZZ_SHARED(n)->child_count ? ZZ_SHARED(n)->children[0] : NULL;
 	if (n->children.next == &n->children)
 		return NULL;
 	return zz_list_entry(n->children.next, struct zz_node, siblings);
 }
 static inline struct zz_node *zz_last_child(struct zz_node *n)
 {
+	if (zz_is_compact(n))
+		return ZZ_COMPACT(n)->last_child;
+	if (zz_is_shared(n))
+		return ZZ_SHARED(n)->child_count ?
+			ZZ_SHARED(n)->children[ZZ_SHARED(n)->child_count - 1] : NULL;
 	if (n->children.prev == &n->children)
 		return NULL;
 	return zz_list_entry(n->children.prev, struct zz_node, siblings);
 }
 /**
- * Destroy node and its children recursively
+ * Get the child after and before ``c``, that is child number ``i`` of
+ * ``p``; used by the iteration macros, so that shared nodes need not search
+ * for ``c``
  */
-static inline void zz_destroy(struct zz_node *n)
+static inline struct zz_node *zz_next_child(struct zz_node *p, struct zz_node *c,
+		size_t i)
 {
-	struct zz_node *i, *x;
-	zz_foreach_child_safe(i, x, n)
-		zz_destroy(i);
-	zz_list_unlink(&n->allocated);
-	zz_data_destroy(n->data);
-	free(n);
+	if (zz_is_shared(p))
+		return i + 1 < ZZ_SHARED(p)->child_count ?
+			ZZ_SHARED(p)->children[i + 1] : NULL;
+	return zz_next_sibling(p, c);
+}
+static inline struct zz_node *zz_prev_child(struct zz_node *p, struct zz_node *c,
+		size_t i)
+{
+	if (zz_is_shared(p))
+		return i > 0 ? ZZ_SHARED(p)->children[i - 1] : NULL;
+	return zz_prev_sibling(p, c);
+}
+/**
+ * Index of the last child of a shared node; 0 for other nodes, whose
+ * iteration does not use it
+ */
+static inline size_t zz_last_index(struct zz_node *n)
+{
+	return zz_is_shared(n) ? ZZ_SHARED(n)->child_count - 1 : 0;
 }
 /**
- * Append and prepend child to node
+ * Iterate on children list, forward and backwards; the safe functions tike an
+ * additional argument that is used as temporary storage and allows unlinking
+ * the iterator inside the loop. The loops keep the index of the iterator in
+ * a variable of their own, ``zz_i_``.
+ */
+#define zz_foreach_child(iter, node) \
+for (size_t zz_i_ = ((iter) = zz_first_child(node), 0); (iter) != NULL; \
+		(iter) = zz_next_child(node, iter, zz_i_++))
+#define zz_reverse_foreach_child(iter, node) \
+for (size_t zz_i_ = ((iter) = zz_last_child(node), zz_last_index(node)); \
+		(iter) != NULL; (iter) = zz_prev_child(node, iter, zz_i_--))
+#define zz_foreach_child_safe(iter, temp, node) \
+for (size_t zz_i_ = ((iter) = zz_first_child(node), \
+			(temp) = (iter) ? zz_next_child(node, iter, 0) : NULL, 0); \
+		(iter) != NULL; \
+		(iter) = (temp), ++zz_i_, \
+		(temp) = (iter) ? zz_next_child(node, iter, zz_i_) : NULL)
+#define zz_reverse_foreach_child_safe(iter, temp, node) \
+for (size_t zz_i_ = ((iter) = zz_last_child(node), \
+			(temp) = (iter) ? zz_prev_child(node, iter, \
+				zz_last_index(node)) : NULL, zz_last_index(node)); \
+		(iter) != NULL; \
+		(iter) = (temp), --zz_i_, \
+		(temp) = (iter) ? zz_prev_child(node, iter, zz_i_) : NULL)
+/**
+ * Destroy node and its children recursively; their memory is given back to
+ * the tree that created them
+ */
+void zz_destroy(struct zz_node *n);
+/**
+ * Append and prepend child to node. A node has a single parent, so ``c`` must
+ * not be the child of another node; unlink it first to move it. Nodes with
+ * parent links assert it. The only way to use a subtree in several places is
+ * a tree created with ``ZZ_TREE_SHARED``, whose nodes get their children from
+ * zz_node_shared() instead.
  */
 static inline void zz_append_child(struct zz_node *p, struct zz_node *c)
 {
-	zz_list_append(&p->children, &c->siblings);
+	struct zz_compact_node *cp;
+	assert(!zz_is_shared(p));
+	assert(!zz_has_parents(c) || zz_links(c)->parent == NULL);
+	if (zz_is_compact(p)) {
+		cp = ZZ_COMPACT(p);
+		if (cp->last_child == NULL)
+			cp->first_child = c;
+		else
+			ZZ_COMPACT(cp->last_child)->next_sibling = c;
+		cp->last_child = c;
+		ZZ_COMPACT(c)->next_sibling = NULL;
+	} else {
+		zz_list_append(&p->children, &c->siblings);
+	}
+	if (zz_has_parents(p)) {
+		zz_links(c)->parent = p;
+		++zz_links(p)->child_count;
+	}
+	zz_invalidate_hash(p);
 }
 static inline void zz_prepend_child(struct zz_node *p, struct zz_node *c)
 {
-	zz_list_prepend(&p->children, &c->siblings);
+	struct zz_compact_node *cp;
+	assert(!zz_is_shared(p));
+	assert(!zz_has_parents(c) || zz_links(c)->parent == NULL);
+	if (zz_is_compact(p)) {
+		cp = ZZ_COMPACT(p);
+		if (cp->last_child == NULL)
+			cp->last_child = c;
+		ZZ_COMPACT(c)->next_sibling = cp->first_child;
+		cp->first_child = c;
+	} else {
+		zz_list_prepend(&p->children, &c->siblings);
+	}
+	if (zz_has_parents(p)) {
+		zz_links(c)->parent = p;
+		++zz_links(p)->child_count;
+		++zz_links(p)->cursor_index;
+	}
+	zz_invalidate_hash(p);
+}
+/**
+ * Remove child ``c`` from node ``p``; takes linear time for compact nodes
+ */
+static inline void zz_remove_child(struct zz_node *p, struct zz_node *c)
+{
+	struct zz_compact_node *cp;
+	struct zz_node *prev;
+	assert(!zz_is_shared(p));
+	if (zz_is_compact(p)) {
+		cp = ZZ_COMPACT(p);
+		prev = zz_prev_sibling(p, c);
+		if (prev == NULL)
+			cp->first_child = ZZ_COMPACT(c)->next_sibling;
+		else
+			ZZ_COMPACT(prev)->next_sibling = ZZ_COMPACT(c)->next_sibling;
+		if (cp->last_child == c)
+			cp->last_child = prev;
+		ZZ_COMPACT(c)->next_sibling = NULL;
+	} else {
+		zz_list_unlink(&c->siblings);
+	}
+	if (zz_has_parents(p)) {
+		zz_links(c)->parent = NULL;
+		--zz_links(p)->child_count;
+		zz_links(p)->cursor = NULL;
+	}
+	zz_invalidate_hash(p);
+}
+/**
+ * Get parent of node, or ``NULL`` if it is a root; only available for nodes
+ * with parent links
+ */
+static inline struct zz_node *zz_parent(struct zz_node *n)
+{
+	assert(zz_has_parents(n));
+	return zz_links(n)->parent;
 }
 /**
- * Remove node from its parent
+ * Remove node from its parent; not available for compact nodes without parent
+ * links, that don't know their parent, nor for shared nodes
  */
 static inline void zz_unlink_child(struct zz_node *n)
 {
+	assert(!zz_is_shared(n));
+	if (zz_has_parents(n)) {
+		if (zz_links(n)->parent != NULL)
+			zz_remove_child(zz_links(n)->parent, n);
+		return;
+	}
+	assert(!zz_is_compact(n));
 	zz_list_unlink(&n->siblings);
 }
+/**
+ * Number of children of node; takes linear time for nodes without parent
+ * links, except shared ones
+ */
+static inline size_t zz_child_count(struct zz_node *n)
+{
+	struct zz_node *i;
+	size_t count = 0;
+	if (zz_is_shared(n))
+		return ZZ_SHARED(n)->child_count;
+	if (zz_has_parents(n))
+		return zz_links(n)->child_count;
+	zz_foreach_child(i, n)
+		++count;
+	return count;
+}
+/**
+ * Get child of node at ``index``, or ``NULL`` if there isn't one. Shared
+ * nodes take constant time. Nodes with parent links start from the child
+ * found by the previous call, so walking the children in order takes constant
+ * time per child; others start from the first child.
+ */
+struct zz_node *zz_child(struct zz_node *n, size_t index);
 /**
  * Check type of payload
  */
@@ -148,7 +471,11 @@ static inline double zz_get_double(struct zz_node *n)
 }
 static inline const char *zz_get_string(struct zz_node *n)
 {
-	return zz_to_string(n->data);
+	return zz_data_string(&n->data);
+}
+static inline size_t zz_get_string_length(struct zz_node *n)
+{
+	return zz_string_length(n->data);
 }
 static inline void *zz_get_pointer(struct zz_node *n)
 {
@@ -159,31 +486,43 @@ static inline void *zz_get_pointer(struct zz_node *n)
  */
 static inline void zz_set_null(struct zz_node *n)
 {
+	zz_invalidate_hash(n);
 	zz_data_destroy(n->data);
 	n->data = zz_null;
 }
 static inline void zz_set_int(struct zz_node *n, int d)
 {
+	zz_invalidate_hash(n);
 	zz_data_destroy(n->data);
 	n->data = zz_int(d);
 }
 static inline void zz_set_uint(struct zz_node *n, unsigned int d)
 {
+	zz_invalidate_hash(n);
 	zz_data_destroy(n->data);
 	n->data = zz_uint(d);
 }
 static inline void zz_set_double(struct zz_node *n, double d)
 {
+	zz_invalidate_hash(n);
 	zz_data_destroy(n->data);
 	n->data = zz_double(d);
 }
 static inline void zz_set_string(struct zz_node *n, const char *d)
 {
+	zz_invalidate_hash(n);
+	zz_data_destroy(n->data);
+	n->data = zz_tree_string(n->tree, d);
+}
+static inline void zz_set_string_n(struct zz_node *n, const char *d, size_t len)
+{
+	zz_invalidate_hash(n);
 	zz_data_destroy(n->data);
-	n->data = zz_string(d);
+	n->data = zz_tree_string_n(n->tree, d, len);
 }
 static inline void zz_set_pointer(struct zz_node *n, void *d)
 {
+	zz_invalidate_hash(n);
 	zz_data_destroy(n->data);
 	n->data = zz_pointer(d);
 }
@@ -2,89 +2,414 @@
 
 #include "print.h"
 
-void zz_print(struct zz_node *node, FILE * f)
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "stack.h"
+
+/* Size of the buffer used by zz_print() before flushing to the file */
+#define PRINT_BUFFER_SIZE 8192
+
+/* Destination of the print engine: either a file, flushed whenever the
+ * buffer is full, or a buffer that grows as needed */
+struct printer {
+	char *data;
+	size_t size;
+	size_t alloc;
+	FILE *file;
+	char *user_data;
+	int error;
+};
+
+static void flush(struct printer *p)
+{
+	if (p->size != 0 && fwrite(p->data, 1, p->size, p->file) != p->size)
+		p->error = 1;
+	p->size = 0;
+}
+
+/* Make room for at least ``len`` bytes; returns 0 if there is none */
+static int reserve(struct printer *p, size_t len)
+{
+	size_t alloc;
+	char *data;
+
+	if (p->alloc - p->size >= len)
+		return 1;
+	if (p->file != NULL) {
+		flush(p);
+		return p->alloc >= len;
+	}
+	alloc = p->alloc ? p->alloc : 64;
+	while (alloc - p->size < len)
+		alloc *= 2;
+	if (p->data == p->user_data) {
+		data = malloc(alloc);
+		if (data != NULL && p->size != 0)
+			memcpy(data, p->data, p->size);
+	} else {
+		data = realloc(p->data, alloc);
+	}
+	if (data == NULL) {
+		p->error = 1;
+		return 0;
+	}
+	p->data = data;
+	p->alloc = alloc;
+	return 1;
+}
+
+static void put(struct printer *p, const char *str, size_t len)
 {
-	struct zz_node *iter;
+	if (reserve(p, len)) {
+		memcpy(p->data + p->size, str, len);
+		p->size += len;
+	} else if (p->file != NULL && fwrite(str, 1, len, p->file) != len) {
+		p->error = 1;
+	}
+}
 
-	fprintf(f, "[%s", node->token);
+static inline void put_char(struct printer *p, char c)
+{
+	if (reserve(p, 1))
+		p->data[p->size++] = c;
+}
+
+/* Format ``x`` backwards, ending right before ``end``; returns the start */
+static char *format_uint(char *end, unsigned long long x)
+{
+	do {
+		*--end = '0' + x % 10;
+		x /= 10;
+	} while (x != 0);
+	return end;
+}
+
+static void put_int(struct printer *p, long long x)
+{
+	char buf[24], *end = buf + sizeof(buf), *ptr;
+
+	ptr = format_uint(end, x < 0 ? -(unsigned long long)x : x);
+	if (x < 0)
+		*--ptr = '-';
+	put(p, ptr, end - ptr);
+}
+
+static void put_double(struct printer *p, double x)
+{
+	char buf[64], *end = buf + sizeof(buf), *ptr;
+	double scaled;
+	unsigned long long y;
+	int i, len;
+
+	/* If six decimals are enough to represent x exactly, the output of %f is
+	 * the integer x * 1e6 with a decimal point; anything else goes through
+	 * snprintf() to get the same rounding */
+	scaled = (signbit(x) ? -x : x) * 1e6;
+	y = scaled < 0x1p52 ? scaled : 0;
+	if (y == scaled) {
+		ptr = end;
+		for (i = 0; i < 6; ++i) {
+			*--ptr = '0' + y % 10;
+			y /= 10;
+		}
+		*--ptr = '.';
+		ptr = format_uint(ptr, y);
+		if (signbit(x))
+			*--ptr = '-';
+		put(p, ptr, end - ptr);
+		return;
+	}
+	len = snprintf(buf, sizeof(buf), "%f", x);
+	if (len < sizeof(buf)) {
+		put(p, buf, len);
+	} else if (reserve(p, len + 1)) {
+		snprintf(p->data + p->size, len + 1, "%f", x);
+		p->size += len;
+	}
+}
+
+static void put_pointer(struct printer *p, void *x)
+{
+	char buf[32];
+	int len;
+
+	len = snprintf(buf, sizeof(buf), "%p", x);
+	put(p, buf, len);
+}
+
+static void print_node(struct printer *p, struct zz_node *node)
+{
+	const char *str;
+
+	put_char(p, '[');
+	put(p, node->token, strlen(node->token));
 
 	switch (node->data.type) {
 	case ZZ_NULL:
 		break;
 	case ZZ_INT:
-		fprintf(f, " %d", node->data.data.int_val);
+		put_char(p, ' ');
+		put_int(p, node->data.data.int_val);
 		break;
 	case ZZ_UINT:
-		fprintf(f, " %u", node->data.data.uint_val);
+		put_char(p, ' ');
+		put_int(p, node->data.data.uint_val);
 		break;
 	case ZZ_DOUBLE:
-		fprintf(f, " %f", node->data.data.double_val);
+		put_char(p, ' ');
+		put_double(p, node->data.data.double_val);
 		break;
 	case ZZ_STRING:
-		fprintf(f, " \"%s\"", node->data.data.string_val);
+		str = zz_data_string(&node->data);
+		put(p, " \"", 2);
+		put(p, str, strlen(str));
+		put_char(p, '"');
 		break;
 	case ZZ_POINTER:
-		fprintf(f, " %p", node->data.data.pointer_val);
+		put_char(p, ' ');
+		put_pointer(p, node->data.data.pointer_val);
 		break;
 	}
+}
+
+static void print_tree(struct printer *p, struct zz_node *node)
+{
+	struct zz_stack parents;
+	struct zz_node *next;
+	size_t index = 0;
+
+	/* Walk the tree keeping the ancestors of the current node in a stack,
+	 * so that the call stack does not grow with the depth of the tree; each
+	 * is pushed with the index of the child being printed, so that nodes
+	 * shared by several parents are found in their place */
+	zz_stack_init(&parents);
+	for (;;) {
+		print_node(p, node);
+		next = zz_first_child(node);
+		if (next != NULL) {
+			zz_stack_push(&parents, node);
+			zz_stack_push(&parents, (void *)(uintptr_t)index);
+			put_char(p, ' ');
+			node = next;
+			index = 0;
+			continue;
+		}
+		put_char(p, ']');
+		while (!zz_stack_empty(&parents)) {
+			next = zz_next_child(parents.data[parents.size - 2], node,
+					index);
+			if (next != NULL)
+				break;
+			index = (uintptr_t)zz_stack_pop(&parents);
+			node = zz_stack_pop(&parents);
+			put_char(p, ']');
+		}
+		if (next == NULL)
+			break;
+		put_char(p, ' ');
+		node = next;
+		++index;
+	}
+	zz_stack_destroy(&parents);
+}
+
+void zz_print(struct zz_node *node, FILE * f)
+{
+	char buf[PRINT_BUFFER_SIZE];
+	struct printer p = { buf, 0, sizeof(buf), f, buf, 0 };
+
+	print_tree(&p, node);
+	flush(&p);
+}
+
+char *zz_print_to_buffer(struct zz_node *node, char *buf, size_t *size)
+{
+	struct printer p = { buf, 0, buf ? *size : 0, NULL, buf, 0 };
+
+	print_tree(&p, node);
+	put_char(&p, 0);
+	if (p.error) {
+		if (p.data != buf)
+			free(p.data);
+		return NULL;
+	}
+	*size = p.size - 1;
+	return p.data;
+}
+
+/* Source file mapped in memory, plus the offset where each line starts */
+struct source {
+	struct source *next;
+	char *path;
+	const char *data;
+	size_t size;
+	size_t *lines;
+	size_t line_count;
+};
+
+/* Sources seen by zz_error(), most recently used first */
+static struct source *sources;
+static pthread_mutex_t sources_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct source *source_open(const char *path)
+{
+	struct source *s;
+	struct stat st;
+	const char *p, *end;
+	size_t alloc;
+	void *data;
+	int fd;
 
-	zz_foreach_child(iter, node) {
-		fprintf(f, " ");
-		zz_print(iter, f);
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+	if (fstat(fd, &st) < 0) {
+		close(fd);
+		return NULL;
 	}
+	data = "";
+	if (st.st_size > 0) {
+		data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED) {
+			close(fd);
+			return NULL;
+		}
+	}
+	close(fd);
 
-	fprintf(f, "]");
+	s = calloc(1, sizeof(*s));
+	s->path = strdup(path);
+	s->data = data;
+	s->size = st.st_size;
+	alloc = 16;
+	s->lines = malloc(alloc * sizeof(*s->lines));
+	s->lines[s->line_count++] = 0;
+	end = s->data + s->size;
+	for (p = s->data; p != end; ++p) {
+		p = memchr(p, '\n', end - p);
+		if (p == NULL)
+			break;
+		if (s->line_count == alloc) {
+			alloc *= 2;
+			s->lines = realloc(s->lines, alloc * sizeof(*s->lines));
+		}
+		s->lines[s->line_count++] = p + 1 - s->data;
+	}
+	return s;
+}
+
+static void source_close(struct source *s)
+{
+	if (s->size != 0)
+		munmap((void *)s->data, s->size);
+	free(s->lines);
+	free(s->path);
+	free(s);
+}
+
+static struct source *source_get(const char *path)
+{
+	struct source **iter, *s;
+
+	for (iter = &sources; *iter != NULL; iter = &(*iter)->next) {
+		s = *iter;
+		if (strcmp(s->path, path) == 0) {
+			*iter = s->next;
+			s->next = sources;
+			sources = s;
+			return s;
+		}
+	}
+	s = source_open(path);
+	if (s != NULL) {
+		s->next = sources;
+		sources = s;
+	}
+	return s;
+}
+
+/* Print line ``i`` of ``s``, then a line with carets under the characters
+ * between ``first`` and ``last``, inclusive, keeping whitespace */
+static void print_line(struct source *s, size_t i, size_t first, size_t last,
+		FILE *f)
+{
+	char buf[256];
+	const char *line;
+	size_t len, size, j;
+
+	/* Lines past the end of the file are empty */
+	if (i < s->line_count) {
+		line = s->data + s->lines[i - 1];
+		len = s->lines[i] - 1 - s->lines[i - 1];
+	} else if (i == s->line_count) {
+		line = s->data + s->lines[i - 1];
+		len = s->size - s->lines[i - 1];
+	} else {
+		line = NULL;
+		len = 0;
+	}
+	if (len != 0)
+		fwrite(line, 1, len, f);
+	fputc('\n', f);
+
+	size = 0;
+	for (j = 1; j <= len; ++j) {
+		if (size == sizeof(buf)) {
+			fwrite(buf, 1, size, f);
+			size = 0;
+		}
+		if (line[j - 1] == '\t' || line[j - 1] == ' ')
+			buf[size++] = line[j - 1];
+		else if (j < first || j > last)
+			buf[size++] = ' ';
+		else
+			buf[size++] = '^';
+	}
+	fwrite(buf, 1, size, f);
+	fputc('\n', f);
 }
 
 void zz_error(const char *msg, const char *file, size_t first_line,
 		size_t first_column, size_t last_line, size_t last_column)
 {
+	struct source *s;
+	size_t i;
+
 	if (file == NULL) {
 		fprintf(stderr, "<file>:%zu: %s\n", first_line, msg);
 		return;
 	}
 	fprintf(stderr, "%s:%zu: %s", file, first_line, msg);
-	FILE *f = fopen(file, "r");
-	if (f == NULL)
-		return;
-	fseek(f, 0, SEEK_SET);
-	for (int i = 1; i < first_line; ++i) {
-                for (;;) {
-                        int c = fgetc(f);
-                        if (c == '\n')
-                                break;
-                        if (c == EOF)
-                                break;
-                }
-	}
-        char *buf = NULL;
-        int size = 0;
-        int alloc = 0;
-	fputc('\n', stderr);
-        for (int i = first_line; i <= last_line; ++i) {
-                size = 0;
-                for (int j = 1;; ++j) {
-                        int c = fgetc(f);
-                        if (c == EOF)
-                                c = '\n';
-                        fputc(c, stderr);
-                        if (size == alloc) {
-                                alloc = alloc ? alloc * 2 : 2;
-                                buf = realloc(buf, alloc);
-                        }
-                        if (c == '\t' || c == '\n' || c == ' ')
-                                buf[size++] = c;
-                        else if ((i == first_line && j < first_column) ||
-                                        (i == last_line && j > last_column))
-                                buf[size++] = ' ';
-                        else
-                                buf[size++] = '^';
-                        if (c == '\n')
-                                break;
-                }
-                buf[size] = 0;
-                fputs(buf, stderr);
-        }
-        free(buf);
-	fclose(f);
+	pthread_mutex_lock(&sources_lock);
+	s = source_get(file);
+	if (s != NULL) {
+		fputc('\n', stderr);
+		/* There is no line 0; start at line 1 anyway */
+		for (i = first_line; i <= last_line; ++i)
+			print_line(s, i + (first_line == 0),
+					i == first_line ? first_column : 0,
+					i == last_line ? last_column : SIZE_MAX,
+					stderr);
+	}
+	pthread_mutex_unlock(&sources_lock);
+}
+
+void zz_error_cache_clear(void)
+{
+	struct source *s;
+
+	pthread_mutex_lock(&sources_lock);
+	while (sources != NULL) {
+		s = sources;
+		sources = s->next;
+		source_close(s);
+	}
+	pthread_mutex_unlock(&sources_lock);
 }
@@ -18,15 +18,32 @@ extern "C" {
  * Print the full tree whose root is ``node`` to ``f`` 
  */
 void zz_print(struct zz_node *node, FILE *f);
+/**
+ * Print the full tree whose root is ``node`` to a string
+ *
+ * If ``buf`` is not ``NULL``, the first ``*size`` bytes of it are used, and
+ * only if the output doesn't fit a new buffer is allocated with malloc(), that
+ * must be released by the caller. Returns the NUL-terminated output and stores
+ * its length in ``*size``, or returns ``NULL`` if memory can't be allocated.
+ */
+char *zz_print_to_buffer(struct zz_node *node, char *buf, size_t *size);
 
 /**
  * Print error message
  *
  * Prints an error message including the file name ``file`` and line ``line``,
  * then prints the offending line and a caret pointing at the offending column.
+ *
+ * Every file is mapped in memory and indexed by line the first time it is
+ * needed, and kept until zz_error_cache_clear() is called.
  */
 void zz_error(const char *msg, const char *file, size_t first_line,
 		size_t first_column, size_t last_line, size_t last_column);
+/**
+ * Release all files cached by zz_error(); they must not have changed if the
+ * cache is not cleared
+ */
+void zz_error_cache_clear(void);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,416 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#include "serial.h"
+
+#include <string.h>
+
+#include "stack.h"
+
+#define ALIGN8(x) (((x) + 7) & ~(uint64_t)7)
+
+/* Record ``k`` in an array of records ``stride`` bytes apart */
+#define RECORD(recs, k, stride) \
+	((struct zz_file_node *)((char *)(recs) + (k) * (stride)))
+
+/* Map from addresses to indices, used to number tokens and strings */
+struct index {
+	const void **keys;
+	uint32_t *vals;
+	size_t size;
+	size_t count;
+};
+
+static void index_init(struct index *m)
+{
+	m->size = 64;
+	m->count = 0;
+	m->keys = calloc(m->size, sizeof(*m->keys));
+	m->vals = calloc(m->size, sizeof(*m->vals));
+}
+
+static void index_destroy(struct index *m)
+{
+	free(m->keys);
+	free(m->vals);
+}
+
+static size_t index_slot(const void **keys, size_t size, const void *key)
+{
+	size_t i = ((uintptr_t)key >> 4) * 11400714819323198485ULL;
+	for (i &= size - 1; keys[i] != NULL && keys[i] != key; i = (i + 1) & (size - 1))
+		continue;
+	return i;
+}
+
+/* Return index of ``key``, adding it with the next free index if missing */
+static uint32_t index_get(struct index *m, const void *key)
+{
+	const void **keys;
+	uint32_t *vals;
+	size_t i, j;
+
+	i = index_slot(m->keys, m->size, key);
+	if (m->keys[i] != NULL)
+		return m->vals[i];
+	if (m->count * 2 >= m->size) {
+		keys = calloc(m->size * 2, sizeof(*keys));
+		vals = calloc(m->size * 2, sizeof(*vals));
+		for (j = 0; j < m->size; ++j) {
+			if (m->keys[j] != NULL) {
+				i = index_slot(keys, m->size * 2, m->keys[j]);
+				keys[i] = m->keys[j];
+				vals[i] = m->vals[j];
+			}
+		}
+		index_destroy(m);
+		m->keys = keys;
+		m->vals = vals;
+		m->size *= 2;
+		i = index_slot(m->keys, m->size, key);
+	}
+	m->keys[i] = key;
+	m->vals[i] = m->count;
+	return m->count++;
+}
+
+/* Token or string table, ready to be written */
+struct table {
+	struct zz_file_string *entries;
+	const char **strs;
+	uint32_t count;
+	uint64_t size;
+};
+
+/* Lay out the keys of an index as a table starting at ``offset``; they are
+ * strings returned by the dictionary if ``interned`` is set */
+static void table_init(struct table *t, struct index *m, uint64_t offset,
+		int interned)
+{
+	uint64_t pos;
+	size_t i;
+
+	t->count = m->count;
+	t->entries = calloc(m->count + 1, sizeof(*t->entries));
+	t->strs = calloc(m->count + 1, sizeof(*t->strs));
+	for (i = 0; i < m->size; ++i) {
+		if (m->keys[i] != NULL)
+			t->strs[m->vals[i]] = m->keys[i];
+	}
+	pos = offset + m->count * sizeof(*t->entries);
+	for (i = 0; i < m->count; ++i) {
+		t->entries[i].offset = pos;
+		t->entries[i].length = interned ? zz_dict_length(t->strs[i]) :
+			strlen(t->strs[i]);
+		pos += t->entries[i].length + 1;
+	}
+	t->size = ALIGN8(pos) - offset;
+}
+
+static void table_write(struct table *t, FILE *f)
+{
+	static const char zeros[8];
+	uint64_t size;
+	uint32_t i;
+
+	fwrite(t->entries, sizeof(*t->entries), t->count, f);
+	size = t->count * sizeof(*t->entries);
+	for (i = 0; i < t->count; ++i) {
+		fwrite(t->strs[i], 1, t->entries[i].length + 1, f);
+		size += t->entries[i].length + 1;
+	}
+	fwrite(zeros, 1, t->size - size, f);
+	free(t->entries);
+	free(t->strs);
+}
+
+/* Size of the user extension of the nodes of a tree */
+static size_t ext_size(struct zz_tree *tree)
+{
+	return tree->node_size - zz_node_base_size(tree);
+}
+
+int zz_tree_save(struct zz_node *node, FILE *f)
+{
+	struct zz_file_header h;
+	struct zz_file_node *r;
+	struct zz_stack stack;
+	struct index tokens, strings;
+	struct table tok_table, str_table;
+	struct zz_dict *inlined;
+	struct zz_arena inlined_arena;
+	const char *str;
+	struct zz_node *iter;
+	static const char zeros[8];
+	void *tmp;
+	char *recs;
+	size_t ext, stride, count, alloc, k, c, i, size;
+
+	ext = ext_size(node->tree);
+	stride = ALIGN8(sizeof(*r) + ext);
+	index_init(&tokens);
+	index_init(&strings);
+	/* Strings stored inline are interned in a pool of their own, so that
+	 * they have an address and a length like any other */
+	inlined = NULL;
+	zz_arena_init(&inlined_arena, 4096, &zz_default_allocator);
+	recs = NULL;
+	count = alloc = 0;
+
+	/* Write records in preorder; ``next`` holds the size of the subtree
+	 * until all of them are known */
+	zz_stack_init(&stack);
+	zz_stack_push(&stack, node);
+	while (!zz_stack_empty(&stack)) {
+		node = zz_stack_pop(&stack);
+		if (count == alloc) {
+			alloc = alloc ? alloc * 2 : 256;
+			recs = realloc(recs, alloc * stride);
+		}
+		r = RECORD(recs, count++, stride);
+		memset(r, 0, stride);
+		r->token = index_get(&tokens, node->token);
+		r->type = node->data.type;
+		switch (node->data.type) {
+		case ZZ_NULL:
+		case ZZ_POINTER:
+			break;
+		case ZZ_INT:
+			r->data.int_val = node->data.data.int_val;
+			break;
+		case ZZ_UINT:
+			r->data.uint_val = node->data.data.uint_val;
+			break;
+		case ZZ_DOUBLE:
+			r->data.double_val = node->data.data.double_val;
+			break;
+		case ZZ_STRING:
+			str = node->data.data.string_val;
+			if (zz_string_is_inline(node->data))
+				inlined = zz_dict_intern_n(inlined, &inlined_arena,
+						node->data.data.inline_val,
+						zz_string_length(node->data), &str);
+			r->data.string_val = index_get(&strings, str);
+			break;
+		}
+		memcpy(r + 1, (char *)node + zz_node_base_size(node->tree), ext);
+		/* Children are pushed in order and then reversed, because
+		 * iterating backwards is slow on compact trees */
+		zz_foreach_child(iter, node) {
+			zz_stack_push(&stack, iter);
+			++r->child_count;
+		}
+		for (i = 0; i < r->child_count / 2; ++i) {
+			tmp = stack.data[stack.size - 1 - i];
+			stack.data[stack.size - 1 - i] =
+				stack.data[stack.size - r->child_count + i];
+			stack.data[stack.size - r->child_count + i] = tmp;
+		}
+	}
+	zz_stack_destroy(&stack);
+
+	for (k = count; k-- > 0; ) {
+		r = RECORD(recs, k, stride);
+		size = 1;
+		for (i = 0; i < r->child_count; ++i)
+			size += RECORD(recs, k + size, stride)->next;
+		r->next = size;
+	}
+	/* Every node replaces the subtree sizes of its children with the
+	 * index of their next sibling */
+	for (k = 0; k < count; ++k) {
+		r = RECORD(recs, k, stride);
+		c = k + 1;
+		for (i = 0; i < r->child_count; ++i) {
+			size = RECORD(recs, c, stride)->next;
+			RECORD(recs, c, stride)->next =
+				i + 1 < r->child_count ? c + size : 0;
+			c += size;
+		}
+	}
+	RECORD(recs, 0, stride)->next = 0;
+
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, ZZ_FILE_MAGIC, sizeof(h.magic));
+	h.version = ZZ_FILE_VERSION;
+	h.byte_order = 1;
+	h.ext_size = ext;
+	h.node_stride = stride;
+	h.token_count = tokens.count;
+	h.string_count = strings.count;
+	h.node_count = count;
+	h.tokens_offset = ALIGN8(sizeof(h));
+	table_init(&tok_table, &tokens, h.tokens_offset, 0);
+	h.strings_offset = h.tokens_offset + tok_table.size;
+	table_init(&str_table, &strings, h.strings_offset, 1);
+	h.nodes_offset = h.strings_offset + str_table.size;
+	h.file_size = h.nodes_offset + count * stride;
+
+	fwrite(&h, sizeof(h), 1, f);
+	fwrite(zeros, 1, h.tokens_offset - sizeof(h), f);
+	table_write(&tok_table, f);
+	table_write(&str_table, f);
+	fwrite(recs, stride, count, f);
+
+	free(recs);
+	index_destroy(&tokens);
+	index_destroy(&strings);
+	zz_dict_destroy(inlined);
+	zz_arena_destroy(&inlined_arena);
+	return ferror(f) ? -1 : 0;
+}
+
+/* Read a table and check that it is well formed; return NULL otherwise */
+static struct zz_file_string *read_table(const char *buf, uint64_t size,
+		uint64_t offset, uint32_t count)
+{
+	struct zz_file_string *table;
+	uint32_t i;
+
+	if (offset % 8 != 0 || offset > size ||
+			(size - offset) / sizeof(*table) < count)
+		return NULL;
+	table = (struct zz_file_string *)(buf + offset);
+	for (i = 0; i < count; ++i) {
+		if (table[i].offset > size || table[i].length >= size -
+				table[i].offset ||
+				buf[table[i].offset + table[i].length] != 0)
+			return NULL;
+	}
+	return table;
+}
+
+struct zz_node *zz_tree_load(struct zz_tree *tree, FILE *f,
+		const char *const *tokens, size_t token_count)
+{
+	struct zz_file_header h;
+	struct zz_file_string *tok_table, *str_table;
+	struct zz_file_node *r;
+	struct zz_data *strings, data;
+	const char **toks;
+	struct zz_node *root, *node;
+	struct zz_node **parents;
+	uint32_t *left;
+	size_t depth, i, j;
+	char *buf;
+
+	/* Shared nodes are built from the leaves up, not appended */
+	if (tree->flags & ZZ_TREE_SHARED)
+		return NULL;
+	if (fread(&h, sizeof(h), 1, f) != 1 ||
+			memcmp(h.magic, ZZ_FILE_MAGIC, sizeof(h.magic)) != 0 ||
+			h.version != ZZ_FILE_VERSION || h.byte_order != 1 ||
+			h.ext_size != ext_size(tree) || h.node_count == 0 ||
+			h.node_stride != ALIGN8(sizeof(*r) + h.ext_size) ||
+			h.file_size < sizeof(h) || h.file_size < h.nodes_offset ||
+			h.nodes_offset % 8 != 0 ||
+			(h.file_size - h.nodes_offset) / h.node_stride < h.node_count)
+		return NULL;
+
+	/* Read the whole file at once */
+	buf = malloc(h.file_size);
+	if (buf == NULL)
+		return NULL;
+	memcpy(buf, &h, sizeof(h));
+	if (fread(buf + sizeof(h), 1, h.file_size - sizeof(h), f) !=
+			h.file_size - sizeof(h)) {
+		free(buf);
+		return NULL;
+	}
+	tok_table = read_table(buf, h.file_size, h.tokens_offset, h.token_count);
+	str_table = read_table(buf, h.file_size, h.strings_offset, h.string_count);
+	if (tok_table == NULL || str_table == NULL) {
+		free(buf);
+		return NULL;
+	}
+
+	/* Match token names */
+	toks = calloc(h.token_count + 1, sizeof(*toks));
+	for (i = 0; i < h.token_count; ++i) {
+		for (j = 0; j < token_count; ++j) {
+			if (strcmp(tokens[j], buf + tok_table[i].offset) == 0) {
+				toks[i] = tokens[j];
+				break;
+			}
+		}
+		if (toks[i] == NULL) {
+			free(toks);
+			free(buf);
+			return NULL;
+		}
+	}
+
+	/* Intern every string once, and share it among the nodes */
+	strings = calloc(h.string_count + 1, sizeof(*strings));
+	for (i = 0; i < h.string_count; ++i)
+		strings[i] = zz_tree_string_n(tree, buf + str_table[i].offset,
+				str_table[i].length);
+
+	zz_tree_reserve(tree, h.node_count);
+	parents = calloc(h.node_count, sizeof(*parents));
+	left = calloc(h.node_count, sizeof(*left));
+	root = NULL;
+	depth = 0;
+	for (i = 0; i < h.node_count; ++i) {
+		r = RECORD(buf + h.nodes_offset, i, h.node_stride);
+		if (r->token >= h.token_count || (i > 0 && depth == 0) ||
+				(r->type == ZZ_STRING &&
+				 r->data.string_val >= h.string_count))
+			goto fail;
+		switch (r->type) {
+		case ZZ_NULL:
+			data = zz_null;
+			break;
+		case ZZ_INT:
+			data = zz_int(r->data.int_val);
+			break;
+		case ZZ_UINT:
+			data = zz_uint(r->data.uint_val);
+			break;
+		case ZZ_DOUBLE:
+			data = zz_double(r->data.double_val);
+			break;
+		case ZZ_STRING:
+			data = zz_data_copy(strings[r->data.string_val]);
+			break;
+		case ZZ_POINTER:
+			data = zz_pointer(NULL);
+			break;
+		default:
+			goto fail;
+		}
+		node = zz_node(tree, toks[r->token], data);
+		memcpy((char *)node + zz_node_base_size(tree), r + 1, h.ext_size);
+		if (root == NULL)
+			root = node;
+		if (depth > 0) {
+			zz_append_child(parents[depth - 1], node);
+			--left[depth - 1];
+		}
+		if (r->child_count > 0) {
+			parents[depth] = node;
+			left[depth] = r->child_count;
+			++depth;
+		} else {
+			while (depth > 0 && left[depth - 1] == 0)
+				--depth;
+		}
+	}
+	if (depth > 0)
+		goto fail;
+
+done:
+	for (i = 0; i < h.string_count; ++i)
+		zz_data_destroy(strings[i]);
+	free(strings);
+	free(parents);
+	free(left);
+	free(toks);
+	free(buf);
+	return root;
+
+fail:
+	if (root != NULL)
+		zz_destroy(root);
+	root = NULL;
+	goto done;
+}
@@ -0,0 +1,113 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#ifndef ZEBU_SERIAL_H_
+#define ZEBU_SERIAL_H_
+
+#include <stdint.h>
+
+#include "tree.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Serialization
+ * -------------
+ *
+ * Compact binary format to save trees to files and load them back.
+ *
+ * A file starts with a ``zz_file_header``, and has three sections at the
+ * offsets given by it:
+ *
+ *    +--------------------+--------------------------------------------------+
+ *    | tokens             | a ``zz_file_string`` per token name, followed by |
+ *    |                    | the NUL-terminated names                         |
+ *    +--------------------+--------------------------------------------------+
+ *    | strings            | a ``zz_file_string`` per distinct string         |
+ *    |                    | payload, followed by the NUL-terminated strings  |
+ *    +--------------------+--------------------------------------------------+
+ *    | nodes              | a ``zz_file_node`` per node in preorder, each    |
+ *    |                    | one followed by the user extension bytes         |
+ *    +--------------------+--------------------------------------------------+
+ *
+ * All integers are in the byte order of the machine that wrote the file, and
+ * all offsets are relative to its start; sections and node records are
+ * aligned to 8 bytes, so that a file can be used in place once mapped in
+ * memory.
+ *
+ * Since tokens are compared by address, loading a tree requires the list of
+ * tokens it may contain; they are matched by name. Pointer payloads refer to
+ * memory of the process that saved the tree, and are loaded as ``NULL``.
+ */
+
+/**
+ * Magic number and version of the format
+ */
+#define ZZ_FILE_MAGIC "ZEBU"
+#define ZZ_FILE_VERSION 1
+
+/**
+ * Header of a file
+ */
+struct zz_file_header {
+	char magic[4];
+	uint32_t version;
+	uint32_t byte_order;
+	uint32_t ext_size;
+	uint32_t node_stride;
+	uint32_t token_count;
+	uint32_t string_count;
+	uint32_t node_count;
+	uint64_t tokens_offset;
+	uint64_t strings_offset;
+	uint64_t nodes_offset;
+	uint64_t file_size;
+};
+
+/**
+ * Entry in the token and string tables
+ */
+struct zz_file_string {
+	uint64_t offset;
+	uint64_t length;
+};
+
+/**
+ * Node record. ``token`` and string payloads are indices in the token and
+ * string tables; the first child of a node, if any, is the next record, and
+ * ``next`` is the index of the next sibling, or 0 if there isn't one.
+ */
+struct zz_file_node {
+	uint32_t token;
+	uint32_t type;
+	uint32_t child_count;
+	uint32_t next;
+	union {
+		int64_t int_val;
+		uint64_t uint_val;
+		double double_val;
+		uint64_t string_val;
+	} data;
+};
+
+/**
+ * Save the tree whose root is ``node`` to ``f``; return 0 on success and -1
+ * on error
+ */
+int zz_tree_save(struct zz_node *node, FILE *f);
+/**
+ * Load a tree from ``f`` into ``tree``, that must have the same node size
+ * as the one it was saved from; ``tokens`` is an array of ``token_count``
+ * tokens. Returns the root node, or ``NULL`` if the file is malformed or uses
+ * tokens that are not in ``tokens``, or if ``tree`` was created with
+ * ``ZZ_TREE_SHARED``.
+ */
+struct zz_node *zz_tree_load(struct zz_tree *tree, FILE *f,
+		const char *const *tokens, size_t token_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif       // ZEBU_SERIAL_H_
@@ -0,0 +1,81 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#ifndef ZEBU_STACK_H_
+#define ZEBU_STACK_H_
+
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Stack
+ * -----
+ *
+ * Growable stack of pointers, used to walk trees without recursion.
+ */
+
+/**
+ * Stack of pointers
+ */
+struct zz_stack {
+	void **data;
+	size_t size;
+	size_t alloc;
+};
+
+/**
+ * Initialize empty stack
+ */
+static inline void zz_stack_init(struct zz_stack *s)
+{
+	s->data = NULL;
+	s->size = 0;
+	s->alloc = 0;
+}
+/**
+ * Release memory held by the stack
+ */
+static inline void zz_stack_destroy(struct zz_stack *s)
+{
+	free(s->data);
+}
+/**
+ * Return ``1`` if empty; ``0`` otherwise
+ */
+static inline int zz_stack_empty(struct zz_stack *s)
+{
+	return s->size == 0;
+}
+/**
+ * Push element
+ */
+static inline void zz_stack_push(struct zz_stack *s, void *p)
+{
+	if (s->size == s->alloc) {
+		s->alloc = s->alloc ? s->alloc * 2 : 64;
+		s->data = (void **)realloc(s->data, s->alloc * sizeof(*s->data));
+	}
+	s->data[s->size++] = p;
+}
+/**
+ * Pop and return element; the stack must not be empty
+ */
+static inline void *zz_stack_pop(struct zz_stack *s)
+{
+	return s->data[--s->size];
+}
+/**
+ * Return the top element without popping it; the stack must not be empty
+ */
+static inline void *zz_stack_top(struct zz_stack *s)
+{
+	return s->data[s->size - 1];
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif       // ZEBU_STACK_H_
@@ -0,0 +1,95 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#include "token.h"
+
+#include <string.h>
+
+#include "dict.h"
+
+/* Size of the first chunk of the arena */
+#define FIRST_CHUNK 1024
+/* Size of the first hash table, which is kept at most half full */
+#define FIRST_TABLE_SIZE 128
+
+void zz_tokens_init(struct zz_tokens *t)
+{
+	t->names = NULL;
+	t->count = 0;
+	t->alloc = 0;
+	t->table = NULL;
+	t->table_size = 0;
+	zz_arena_init(&t->arena, FIRST_CHUNK, &zz_default_allocator);
+}
+
+void zz_tokens_destroy(struct zz_tokens *t)
+{
+	free(t->names);
+	free(t->table);
+	t->names = NULL;
+	t->count = 0;
+	t->alloc = 0;
+	t->table = NULL;
+	t->table_size = 0;
+	zz_arena_destroy(&t->arena);
+}
+
+/* Slot of the hash table that holds the token named ``name``, or the empty
+ * one where it would go */
+static size_t find(const struct zz_tokens *t, const char *name, size_t length)
+{
+	size_t mask = t->table_size - 1, i;
+
+	for (i = zz_dict_hash(name, length) & mask; t->table[i] != NULL;
+			i = (i + 1) & mask) {
+		if (zz_token_length(t->table[i]) == length &&
+				memcmp(t->table[i], name, length) == 0)
+			break;
+	}
+	return i;
+}
+
+/* Double the size of the hash table */
+static void grow(struct zz_tokens *t)
+{
+	const char *name;
+	size_t i;
+
+	free(t->table);
+	t->table_size = t->table_size ? t->table_size * 2 : FIRST_TABLE_SIZE;
+	t->table = calloc(t->table_size, sizeof(*t->table));
+	for (i = 0; i < t->count; ++i) {
+		name = t->names[i];
+		t->table[find(t, name, zz_token_length(name))] = name;
+	}
+}
+
+const char *zz_tokens_lookup(const struct zz_tokens *t, const char *name)
+{
+	if (t->table == NULL)
+		return NULL;
+	return t->table[find(t, name, strlen(name))];
+}
+
+const char *zz_tokens_add(struct zz_tokens *t, const char *name)
+{
+	struct zz_token_entry *e;
+	size_t length, i;
+
+	if ((t->count + 1) * 2 > t->table_size)
+		grow(t);
+	length = strlen(name);
+	i = find(t, name, length);
+	if (t->table[i] != NULL)
+		return t->table[i];
+	if (t->count == t->alloc) {
+		t->alloc = t->alloc ? t->alloc * 2 : 64;
+		t->names = realloc(t->names, t->alloc * sizeof(*t->names));
+	}
+	e = zz_arena_alloc(&t->arena, sizeof(*e) + length + 1);
+	e->id = t->count;
+	e->length = length;
+	memcpy(e->name, name, length + 1);
+	t->names[t->count++] = e->name;
+	t->table[i] = e->name;
+	return e->name;
+}
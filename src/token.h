@@ -0,0 +1,126 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#ifndef ZEBU_TOKEN_H_
+#define ZEBU_TOKEN_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "arena.h"
+#include "tree.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Tokens
+ * ------
+ *
+ * Registry that numbers tokens densely from 0, in the order they are added.
+ *
+ * Tokens returned by the registry are still names compared by address, and
+ * can be used anywhere a token is expected; their number is stored in front
+ * of the name, like the length of a string in the dictionary, so any node
+ * knows the number of its token without a lookup. Numbers can index arrays of
+ * handlers or counters, or be the labels of a ``switch`` when tokens are
+ * added in the order of an ``enum``.
+ *
+ * Tokens are allocated from an arena and live until the registry is
+ * destroyed. Their names are kept in a hash table, so adding or looking up a
+ * token takes constant time on average.
+ */
+
+/**
+ * Token, as stored in the registry
+ */
+struct zz_token_entry {
+	uint32_t id;
+	uint32_t length;
+	char name[];
+};
+
+/**
+ * Registry of tokens
+ */
+struct zz_tokens {
+	const char **names;
+	size_t count;
+	size_t alloc;
+	const char **table;
+	size_t table_size;
+	struct zz_arena arena;
+};
+
+/**
+ * Initialize empty registry
+ */
+void zz_tokens_init(struct zz_tokens *t);
+/**
+ * Destroy registry and its tokens
+ */
+void zz_tokens_destroy(struct zz_tokens *t);
+/**
+ * Get the token named ``name``, adding it with the next number if it is not
+ * in the registry yet
+ */
+const char *zz_tokens_add(struct zz_tokens *t, const char *name);
+/**
+ * Get the token named ``name``, or ``NULL`` if it is not in the registry
+ */
+const char *zz_tokens_lookup(const struct zz_tokens *t, const char *name);
+/**
+ * Return 1 if ``token`` was returned by the registry, and 0 otherwise; only
+ * the name is read, so ``token`` may be any string
+ */
+static inline int zz_tokens_contains(const struct zz_tokens *t,
+		const char *token)
+{
+	return zz_tokens_lookup(t, token) == token;
+}
+/**
+ * Number of tokens
+ */
+static inline size_t zz_tokens_count(const struct zz_tokens *t)
+{
+	return t->count;
+}
+/**
+ * Get the token numbered ``id``, or ``NULL`` if there isn't one
+ */
+static inline const char *zz_tokens_name(const struct zz_tokens *t, size_t id)
+{
+	return id < t->count ? t->names[id] : NULL;
+}
+/**
+ * Get entry for a token returned by a registry
+ */
+static inline const struct zz_token_entry *zz_token_entry(const char *token)
+{
+	return (const struct zz_token_entry *)(token -
+			offsetof(struct zz_token_entry, name));
+}
+/**
+ * Number and length of a token returned by a registry
+ */
+static inline unsigned int zz_token_id(const char *token)
+{
+	return zz_token_entry(token)->id;
+}
+static inline size_t zz_token_length(const char *token)
+{
+	return zz_token_entry(token)->length;
+}
+/**
+ * Number of the token of node, that must come from a registry
+ */
+static inline unsigned int zz_get_token_id(const struct zz_node *n)
+{
+	return zz_token_id(n->token);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif       // ZEBU_TOKEN_H_
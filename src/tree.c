@@ -1,54 +1,1024 @@
 /* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
 
 #include "tree.h"
+#include "stack.h"
+#include "token.h"
 
 #include <ctype.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <string.h>
 
+/* Number of nodes that fit in the first chunk of the arena */
+#define FIRST_CHUNK_NODES 64
+
+/* Size of the first chunk of the string pool */
+#define FIRST_STRING_CHUNK 4096
+
+/* Size of the hash table of shared nodes when it is first created */
+#define FIRST_SHARED_SIZE 64
+
+/* Memory taken by each node, including what is in front of it */
+static size_t node_stride(const struct zz_tree *tree)
+{
+	return tree->node_size + zz_node_prefix_size(tree);
+}
+
 void zz_tree_init(struct zz_tree *tree, size_t node_size)
 {
-	assert(node_size >= sizeof(struct zz_node));
-	tree->node_size = node_size;
+	zz_tree_init_flags(tree, node_size, 0);
+}
+
+void zz_tree_init_flags(struct zz_tree *tree, size_t node_size, unsigned int flags)
+{
+	zz_tree_init_allocator(tree, node_size, flags, &zz_default_allocator);
+}
+
+void zz_tree_init_allocator(struct zz_tree *tree, size_t node_size,
+		unsigned int flags, const struct zz_allocator *allocator)
+{
+	tree->flags = flags;
+	assert(!(flags & ZZ_TREE_SHARED) || !(flags & (ZZ_TREE_COMPACT |
+					ZZ_TREE_PARENTS | ZZ_TREE_TOKEN_INDEX)));
+	assert(!(flags & ZZ_TREE_HASHES) || flags & ZZ_TREE_PARENTS);
+	assert(node_size >= zz_node_base_size(tree));
+	assert(!(flags & ZZ_TREE_SHARED) ||
+			node_size == sizeof(struct zz_shared_node));
+	tree->node_size = zz_arena_align(node_size);
 	zz_list_init(&tree->nodes);
+	zz_list_init(&tree->free_nodes);
+	tree->free_compact = NULL;
+	zz_arena_init(&tree->arena, node_stride(tree) * FIRST_CHUNK_NODES,
+			allocator);
+	tree->strings = NULL;
+	zz_arena_init(&tree->string_arena, FIRST_STRING_CHUNK, allocator);
+	tree->allocator = allocator;
+	tree->node_count = 0;
+	tree->peak_node_count = 0;
+	tree->node_bytes = 0;
+	tree->peak_node_bytes = 0;
+	tree->allocated = 0;
+	tree->string_hits = 0;
+	tree->string_misses = 0;
+	tree->tokens = NULL;
+	tree->token_index = NULL;
+	tree->token_index_size = 0;
+	tree->shared = NULL;
+	tree->shared_size = 0;
+	tree->shared_count = 0;
+	memset(tree->shared_free, 0, sizeof(tree->shared_free));
+}
+
+/* Get memory straight from the allocator, outside the arenas */
+static void *tree_alloc(struct zz_tree *tree, size_t size)
+{
+	tree->allocated += size;
+	return zz_alloc(tree->allocator, size);
+}
+
+static void tree_free(struct zz_tree *tree, void *ptr, size_t size)
+{
+	tree->allocated -= size;
+	zz_free(tree->allocator, ptr, size);
+}
+
+/* Count a node of ``size`` bytes as live */
+static void count_node(struct zz_tree *tree, size_t size)
+{
+	if (++tree->node_count > tree->peak_node_count)
+		tree->peak_node_count = tree->node_count;
+	tree->node_bytes += size;
+	if (tree->node_bytes > tree->peak_node_bytes)
+		tree->peak_node_bytes = tree->node_bytes;
+}
+
+static void uncount_node(struct zz_tree *tree, size_t size)
+{
+	--tree->node_count;
+	tree->node_bytes -= size;
+}
+
+/* Destroy the payload of all live nodes */
+static void destroy_data(struct zz_tree *tree)
+{
+	struct zz_arena_chunk *c;
+	struct zz_node *n;
+	char *p, *end;
+	size_t i;
+
+	if (tree->flags & ZZ_TREE_SHARED) {
+		for (i = 0; i < tree->shared_size; ++i) {
+			if (tree->shared[i] != NULL)
+				zz_data_destroy(tree->shared[i]->data);
+		}
+		return;
+	}
+	if (!(tree->flags & ZZ_TREE_COMPACT)) {
+		zz_list_foreach_entry(n, &tree->nodes, allocated)
+			zz_data_destroy(n->data);
+		return;
+	}
+	for (c = tree->arena.chunks; c != NULL; c = c->next) {
+		end = zz_arena_chunk_end(&tree->arena, c);
+		for (p = zz_arena_chunk_begin(c); p < end; p += node_stride(tree)) {
+			n = (struct zz_node *)(p + zz_node_prefix_size(tree));
+			if (n->tree != NULL)
+				zz_data_destroy(n->data);
+		}
+	}
+}
+
+/* Memory taken by a shared node with ``count`` children */
+static size_t shared_size(const struct zz_tree *tree, size_t count)
+{
+	return tree->node_size + count * sizeof(struct zz_node *);
+}
+
+/* Give back the memory of the live shared nodes that don't come from the
+ * arena */
+static void free_wide_shared(struct zz_tree *tree)
+{
+	struct zz_node *n;
+	size_t i;
+
+	for (i = 0; i < tree->shared_size; ++i) {
+		n = tree->shared[i];
+		if (n != NULL && ZZ_SHARED(n)->child_count >= ZZ_SHARED_FREE_LISTS)
+			tree_free(tree, n, shared_size(tree,
+						ZZ_SHARED(n)->child_count));
+	}
 }
 
 void zz_tree_destroy(struct zz_tree * tree)
 {
-	struct zz_node *n, *x;
-	zz_list_foreach_entry_safe(n, x, &tree->nodes, allocated) {
-		zz_data_destroy(n->data);
-		free(n);
+	destroy_data(tree);
+	if (tree->allocator->release != NULL) {
+		tree->allocator->release(tree->allocator->data);
+		return;
 	}
+	free_wide_shared(tree);
+	if (tree->token_index != NULL)
+		tree_free(tree, tree->token_index,
+				tree->token_index_size * sizeof(*tree->token_index));
+	if (tree->shared != NULL)
+		tree_free(tree, tree->shared,
+				tree->shared_size * sizeof(*tree->shared));
+	zz_arena_destroy(&tree->arena);
+	zz_dict_destroy(tree->strings);
+	zz_arena_destroy(&tree->string_arena);
 }
 
-struct zz_node *zz_node(struct zz_tree * tree, const char *token, struct zz_data data)
+void zz_tree_reset(struct zz_tree *tree)
+{
+	size_t i;
+
+	destroy_data(tree);
+	for (i = 0; i < tree->token_index_size; ++i)
+		zz_list_init(&tree->token_index[i]);
+	free_wide_shared(tree);
+	if (tree->shared != NULL)
+		memset(tree->shared, 0, tree->shared_size * sizeof(*tree->shared));
+	tree->shared_count = 0;
+	memset(tree->shared_free, 0, sizeof(tree->shared_free));
+	zz_list_init(&tree->nodes);
+	zz_list_init(&tree->free_nodes);
+	tree->free_compact = NULL;
+	zz_arena_reset(&tree->arena);
+	zz_dict_clear(tree->strings);
+	zz_arena_reset(&tree->string_arena);
+	tree->node_count = 0;
+	tree->peak_node_count = 0;
+	tree->node_bytes = 0;
+	tree->peak_node_bytes = 0;
+	tree->string_hits = 0;
+	tree->string_misses = 0;
+}
+
+void zz_tree_reserve(struct zz_tree *tree, size_t count)
+{
+	zz_arena_reserve(&tree->arena, node_stride(tree) * count);
+}
+
+void zz_tree_stats(const struct zz_tree *tree, struct zz_tree_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+	stats->nodes = tree->node_count;
+	stats->peak_nodes = tree->peak_node_count;
+	stats->node_bytes = tree->node_bytes;
+	stats->peak_node_bytes = tree->peak_node_bytes;
+	stats->allocated = tree->arena.allocated + tree->string_arena.allocated +
+		tree->allocated + zz_dict_table_size(tree->strings);
+	zz_dict_stats(tree->strings, &stats->strings);
+	stats->strings.hits = tree->string_hits;
+	stats->strings.misses = tree->string_misses;
+}
+
+struct zz_data zz_tree_string(struct zz_tree *tree, const char *str)
+{
+	return zz_tree_string_n(tree, str, strlen(str));
+}
+
+struct zz_data zz_tree_string_n(struct zz_tree *tree, const char *str, size_t length)
+{
+	struct zz_data data = { ZZ_STRING };
+	size_t count;
+
+	if (tree->flags & ZZ_TREE_INLINE_STRINGS && length <= ZZ_INLINE_STRING_MAX)
+		return zz_string_inline(str, length);
+	if (!(tree->flags & ZZ_TREE_STRING_POOL))
+		return zz_string_n(str, length);
+	count = tree->strings ? tree->strings->count : 0;
+	tree->strings = zz_dict_intern_n(tree->strings, &tree->string_arena,
+			str, length, &data.data.string_val);
+	if (tree->strings->count > count)
+		++tree->string_misses;
+	else
+		++tree->string_hits;
+	return data;
+}
+
+/* Get zeroed memory for a new node from the arena */
+static struct zz_node *new_node(struct zz_tree *tree)
+{
+	char *p = zz_arena_alloc(&tree->arena, node_stride(tree));
+	return (struct zz_node *)(p + zz_node_prefix_size(tree));
+}
+
+static void clear_node(struct zz_tree *tree, struct zz_node *n)
+{
+	memset((char *)n - zz_node_prefix_size(tree), 0, node_stride(tree));
+}
+
+/* Get memory for a node, recycling destroyed ones first, and link it */
+static struct zz_node *alloc_node(struct zz_tree *tree)
 {
-	struct zz_node *n = calloc(1, tree->node_size);
+	struct zz_node *n;
+
+	if (!zz_list_empty(&tree->free_nodes)) {
+		n = zz_list_first_entry(&tree->free_nodes, struct zz_node, allocated);
+		zz_list_unlink(&n->allocated);
+	} else {
+		n = new_node(tree);
+	}
+	clear_node(tree, n);
 	zz_list_init(&n->children);
 	zz_list_init(&n->siblings);
 	zz_list_init(&n->allocated);
-	n->token = token;
 	zz_list_append(&tree->nodes, &n->allocated);
+	return n;
+}
+
+static struct zz_node *alloc_compact_node(struct zz_tree *tree)
+{
+	struct zz_node *n;
+
+	if (tree->free_compact != NULL) {
+		n = tree->free_compact;
+		tree->free_compact = ZZ_COMPACT(n)->next_sibling;
+	} else {
+		n = new_node(tree);
+	}
+	clear_node(tree, n);
+	return n;
+}
+
+/* Add node to the list of its token, making room for it in the index */
+static void index_node(struct zz_tree *tree, struct zz_node *n)
+{
+	struct zz_list *index;
+	size_t id, size, i;
+
+	/* Numbers are stored in front of names, so only read them from
+	 * tokens of the registry */
+	assert(tree->tokens != NULL &&
+			zz_tokens_contains(tree->tokens, n->token));
+	id = zz_token_id(n->token);
+	if (id >= tree->token_index_size) {
+		size = tree->token_index_size ? tree->token_index_size * 2 : 16;
+		while (size <= id)
+			size *= 2;
+		index = tree_alloc(tree, size * sizeof(*index));
+		for (i = 0; i < size; ++i) {
+			zz_list_init(&index[i]);
+			if (i < tree->token_index_size)
+				zz_list_swap(&tree->token_index[i], &index[i]);
+		}
+		if (tree->token_index != NULL)
+			tree_free(tree, tree->token_index,
+					tree->token_index_size * sizeof(*index));
+		tree->token_index = index;
+		tree->token_index_size = size;
+	}
+	zz_list_append(&tree->token_index[id], zz_token_link(n));
+}
+
+void zz_tree_set_tokens(struct zz_tree *tree, const struct zz_tokens *tokens)
+{
+	assert(tree->flags & ZZ_TREE_TOKEN_INDEX);
+	assert(tree->node_count == 0);
+	tree->tokens = tokens;
+}
+
+struct zz_node *zz_tree_first_of(struct zz_tree *tree, const char *token)
+{
+	struct zz_list *head;
+	size_t id;
+
+	assert(tree->flags & ZZ_TREE_TOKEN_INDEX);
+	if (tree->tokens == NULL || !zz_tokens_contains(tree->tokens, token))
+		return NULL;
+	id = zz_token_id(token);
+	if (id >= tree->token_index_size)
+		return NULL;
+	head = &tree->token_index[id];
+	if (zz_list_empty(head))
+		return NULL;
+	return (struct zz_node *)((char *)head->next +
+			zz_node_prefix_size(tree));
+}
+
+struct zz_node *zz_tree_next_of(struct zz_node *n)
+{
+	struct zz_tree *tree = n->tree;
+	struct zz_list *link;
+
+	link = zz_token_link(n)->next;
+	if (link == &tree->token_index[zz_token_id(n->token)])
+		return NULL;
+	return (struct zz_node *)((char *)link + zz_node_prefix_size(tree));
+}
+
+/* Structural hash of a node is computed in three steps: from its token and
+ * data, then from the hash of each child in order, and a final mix that
+ * never gives 0, the hash of nodes whose cached hash is unknown. Every step
+ * goes through the full finalizer of splitmix64, so that each bit of a child
+ * changes about half the bits of the result. */
+static size_t hash_mix(size_t x)
+{
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
+
+static size_t hash_start(const char *token, struct zz_data data)
+{
+	return hash_mix(hash_mix((uintptr_t)token) ^ zz_data_hash(data));
+}
+
+static size_t hash_child(size_t hash, size_t child)
+{
+	return hash_mix(hash ^ hash_mix(child + 0x9e3779b97f4a7c15ULL));
+}
+
+static size_t hash_end(size_t hash)
+{
+	hash = hash_mix(hash);
+	return hash ? hash : 1;
+}
+
+/* Hash of a shared node, the same as zz_hash() gives for it */
+static size_t shared_hash(const char *token, struct zz_data data,
+		struct zz_node *const *children, size_t count)
+{
+	size_t hash, i;
+
+	hash = hash_start(token, data);
+	for (i = 0; i < count; ++i)
+		hash = hash_child(hash, ZZ_SHARED(children[i])->hash);
+	return hash_end(hash);
+}
+
+/* Double the size of the hash table of shared nodes, which is kept at most
+ * half full */
+static void grow_shared(struct zz_tree *tree)
+{
+	struct zz_node **table, *n;
+	size_t size, mask, i, j;
+
+	size = tree->shared_size ? tree->shared_size * 2 : FIRST_SHARED_SIZE;
+	table = tree_alloc(tree, size * sizeof(*table));
+	memset(table, 0, size * sizeof(*table));
+	mask = size - 1;
+	for (i = 0; i < tree->shared_size; ++i) {
+		n = tree->shared[i];
+		if (n == NULL)
+			continue;
+		for (j = ZZ_SHARED(n)->hash & mask; table[j] != NULL;
+				j = (j + 1) & mask)
+			continue;
+		table[j] = n;
+	}
+	if (tree->shared != NULL)
+		tree_free(tree, tree->shared,
+				tree->shared_size * sizeof(*table));
+	tree->shared = table;
+	tree->shared_size = size;
+}
+
+static int shared_equal(struct zz_node *n, size_t hash, const char *token,
+		struct zz_data data, struct zz_node *const *children, size_t count)
+{
+	struct zz_shared_node *s = ZZ_SHARED(n);
+
+	return s->hash == hash && n->token == token &&
+		s->child_count == count && zz_data_equal(n->data, data) &&
+		(count == 0 || memcmp(s->children, children,
+				      count * sizeof(*children)) == 0);
+}
+
+/* Get memory for a shared node with ``count`` children, recycling released
+ * ones first */
+static struct zz_node *alloc_shared(struct zz_tree *tree, size_t count)
+{
+	struct zz_node *n;
+
+	if (count >= ZZ_SHARED_FREE_LISTS)
+		return tree_alloc(tree, shared_size(tree, count));
+	n = tree->shared_free[count];
+	if (n == NULL)
+		return zz_arena_alloc(&tree->arena, shared_size(tree, count));
+	tree->shared_free[count] = (struct zz_node *)ZZ_SHARED(n)->children;
+	return n;
+}
+
+/* Remove a shared node from the hash table and free it; entries after it are
+ * moved back so that lookups don't stop at the hole */
+static void free_shared(struct zz_tree *tree, struct zz_node *n)
+{
+	struct zz_shared_node *s = ZZ_SHARED(n);
+	size_t mask, i, j, k;
+
+	mask = tree->shared_size - 1;
+	for (i = s->hash & mask; tree->shared[i] != n; i = (i + 1) & mask)
+		continue;
+	for (j = (i + 1) & mask; tree->shared[j] != NULL; j = (j + 1) & mask) {
+		/* Entry j stays unless its home slot k is cyclically after the
+		 * hole i */
+		k = ZZ_SHARED(tree->shared[j])->hash & mask;
+		if (i <= j ? i < k && k <= j : i < k || k <= j)
+			continue;
+		tree->shared[i] = tree->shared[j];
+		i = j;
+	}
+	tree->shared[i] = NULL;
+	--tree->shared_count;
+	uncount_node(tree, shared_size(tree, s->child_count));
+	zz_data_destroy(n->data);
+	if (s->child_count >= ZZ_SHARED_FREE_LISTS) {
+		tree_free(tree, n, shared_size(tree, s->child_count));
+		return;
+	}
+	s->children = (struct zz_node **)tree->shared_free[s->child_count];
+	tree->shared_free[s->child_count] = n;
+}
+
+/* Drop a reference to a shared node; nodes left without any are freed, and
+ * drop their references to their children in turn */
+static void release_shared(struct zz_node *n)
+{
+	struct zz_tree *tree = n->tree;
+	struct zz_shared_node *s;
+	struct zz_stack pending;
+	size_t i;
+
+	assert(ZZ_SHARED(n)->refs > 0);
+	if (--ZZ_SHARED(n)->refs > 0)
+		return;
+	zz_stack_init(&pending);
+	zz_stack_push(&pending, n);
+	while (!zz_stack_empty(&pending)) {
+		n = zz_stack_pop(&pending);
+		s = ZZ_SHARED(n);
+		for (i = 0; i < s->child_count; ++i) {
+			if (--ZZ_SHARED(s->children[i])->refs == 0)
+				zz_stack_push(&pending, s->children[i]);
+		}
+		free_shared(tree, n);
+	}
+	zz_stack_destroy(&pending);
+}
+
+struct zz_node *zz_node_shared(struct zz_tree *tree, const char *token,
+		struct zz_data data, struct zz_node *const *children, size_t count)
+{
+	struct zz_shared_node *s;
+	struct zz_node *n;
+	size_t hash, mask, i, k;
+
+	assert(tree->flags & ZZ_TREE_SHARED);
+	hash = shared_hash(token, data, children, count);
+	if ((tree->shared_count + 1) * 2 > tree->shared_size)
+		grow_shared(tree);
+	mask = tree->shared_size - 1;
+	for (i = hash & mask; tree->shared[i] != NULL; i = (i + 1) & mask) {
+		n = tree->shared[i];
+		if (shared_equal(n, hash, token, data, children, count)) {
+			zz_data_destroy(data);
+			++ZZ_SHARED(n)->refs;
+			return n;
+		}
+	}
+	/* The children follow the node in the same allocation */
+	n = alloc_shared(tree, count);
+	memset(n, 0, tree->node_size);
+	s = ZZ_SHARED(n);
+	n->token = token;
 	n->data = data;
+	n->tree = tree;
+	s->children = (struct zz_node **)((char *)n + tree->node_size);
+	if (count > 0)
+		memcpy(s->children, children, count * sizeof(*children));
+	s->child_count = count;
+	s->hash = hash;
+	s->refs = 1;
+	for (k = 0; k < count; ++k)
+		++ZZ_SHARED(children[k])->refs;
+	tree->shared[i] = n;
+	++tree->shared_count;
+	count_node(tree, shared_size(tree, count));
 	return n;
 }
 
+struct zz_node *zz_node(struct zz_tree * tree, const char *token, struct zz_data data)
+{
+	struct zz_node *n;
+
+	if (tree->flags & ZZ_TREE_SHARED)
+		return zz_node_shared(tree, token, data, NULL, 0);
+	if (tree->flags & ZZ_TREE_COMPACT)
+		n = alloc_compact_node(tree);
+	else
+		n = alloc_node(tree);
+	n->token = token;
+	n->data = data;
+	n->tree = tree;
+	if (tree->flags & ZZ_TREE_TOKEN_INDEX)
+		index_node(tree, n);
+	count_node(tree, node_stride(tree));
+	return n;
+}
+
+/* Compact nodes waiting to be destroyed form a list through ``next_sibling``;
+ * the children of each are spliced at the front of it in one step */
+static void destroy_compact(struct zz_node *n)
+{
+	struct zz_tree *tree = n->tree;
+	struct zz_node *pending;
+
+	ZZ_COMPACT(n)->next_sibling = NULL;
+	pending = n;
+	while (pending != NULL) {
+		n = pending;
+		pending = ZZ_COMPACT(n)->next_sibling;
+		if (ZZ_COMPACT(n)->first_child != NULL) {
+			ZZ_COMPACT(ZZ_COMPACT(n)->last_child)->next_sibling = pending;
+			pending = ZZ_COMPACT(n)->first_child;
+		}
+		zz_data_destroy(n->data);
+		if (tree->flags & ZZ_TREE_TOKEN_INDEX)
+			zz_list_unlink(zz_token_link(n));
+		n->tree = NULL;
+		ZZ_COMPACT(n)->next_sibling = tree->free_compact;
+		tree->free_compact = n;
+		uncount_node(tree, node_stride(tree));
+	}
+}
+
+void zz_destroy(struct zz_node *n)
+{
+	struct zz_list pending;
+	struct zz_node *i;
+
+	/* Shared nodes may be used elsewhere, and are freed by zz_unref() */
+	if (zz_is_shared(n))
+		return;
+	if (zz_is_compact(n)) {
+		destroy_compact(n);
+		return;
+	}
+	/* Nodes waiting to be destroyed are moved from the list of allocated
+	 * nodes to a local one, so no stack is needed however deep the tree */
+	zz_list_init(&pending);
+	zz_list_unlink(&n->allocated);
+	zz_list_append(&pending, &n->allocated);
+	while (!zz_list_empty(&pending)) {
+		n = zz_list_first_entry(&pending, struct zz_node, allocated);
+		zz_foreach_child(i, n) {
+			zz_list_unlink(&i->allocated);
+			zz_list_append(&pending, &i->allocated);
+		}
+		zz_list_unlink(&n->allocated);
+		zz_data_destroy(n->data);
+		if (n->tree->flags & ZZ_TREE_TOKEN_INDEX)
+			zz_list_unlink(zz_token_link(n));
+		zz_list_append(&n->tree->free_nodes, &n->allocated);
+		uncount_node(n->tree, node_stride(n->tree));
+	}
+}
+
+struct zz_node *zz_ref(struct zz_node *n)
+{
+	assert(zz_is_shared(n));
+	++ZZ_SHARED(n)->refs;
+	return n;
+}
+
+void zz_unref(struct zz_node *n)
+{
+	if (zz_is_shared(n))
+		release_shared(n);
+	else
+		zz_destroy(n);
+}
+
+struct zz_node *zz_child(struct zz_node *n, size_t index)
+{
+	struct zz_node_links *links;
+	struct zz_node *c;
+	size_t i;
+
+	if (zz_is_shared(n))
+		return index < ZZ_SHARED(n)->child_count ?
+			ZZ_SHARED(n)->children[index] : NULL;
+	if (!zz_has_parents(n)) {
+		zz_foreach_child(c, n) {
+			if (index-- == 0)
+				return c;
+		}
+		return NULL;
+	}
+	links = zz_links(n);
+	if (index >= links->child_count)
+		return NULL;
+	/* Start from the cursor if it is before the child, or else from the
+	 * closest end; only full nodes can walk backwards */
+	if (links->cursor != NULL && links->cursor_index <= index &&
+			(zz_is_compact(n) || index - links->cursor_index <
+			 links->child_count - index)) {
+		c = links->cursor;
+		i = links->cursor_index;
+	} else if (!zz_is_compact(n) && index >= links->child_count / 2) {
+		c = zz_last_child(n);
+		for (i = links->child_count - 1; i > index; --i)
+			c = zz_prev_sibling(n, c);
+	} else {
+		c = zz_first_child(n);
+		i = 0;
+	}
+	for (; i < index; ++i)
+		c = zz_next_sibling(n, c);
+	links->cursor = c;
+	links->cursor_index = index;
+	return c;
+}
+
+/* Copy the data of ``node`` for a node of ``tree`` */
+static struct zz_data copy_data(struct zz_tree *tree, struct zz_node *node)
+{
+	struct zz_data data = node->data;
+	/* Strings from a pool can only be shared by nodes of the same tree */
+	if (data.type == ZZ_STRING && !zz_string_is_inline(data) &&
+			(tree->flags & ZZ_TREE_STRING_POOL ?
+				node->tree != tree :
+				zz_dict_pooled(data.data.string_val)))
+		return zz_tree_string_n(tree, data.data.string_val,
+				zz_string_length(data));
+	return zz_data_copy(data);
+}
+
 struct zz_node *zz_copy(struct zz_tree *tree, struct zz_node *node)
 {
-	return zz_node(tree, node->token, zz_data_copy(node->data));
+	return zz_node(tree, node->token, copy_data(tree, node));
+}
+
+/* Shared nodes need their children to be created first, so the copy is built
+ * from the leaves up; frames of three entries (original, its next child to
+ * copy and the index of that child) are pushed on one stack, and the copies
+ * of the children are pushed on another until their parent is created */
+static struct zz_node *copy_shared(struct zz_tree *tree, struct zz_node *node)
+{
+	struct zz_stack frames, built;
+	struct zz_node *src, *child, *copy;
+	size_t i, k;
+
+	zz_stack_init(&frames);
+	zz_stack_init(&built);
+	zz_stack_push(&frames, node);
+	zz_stack_push(&frames, zz_first_child(node));
+	zz_stack_push(&frames, (void *)0);
+	while (!zz_stack_empty(&frames)) {
+		i = (uintptr_t)zz_stack_pop(&frames);
+		child = zz_stack_pop(&frames);
+		src = zz_stack_pop(&frames);
+		if (child != NULL) {
+			zz_stack_push(&frames, src);
+			zz_stack_push(&frames, zz_next_child(src, child, i));
+			zz_stack_push(&frames, (void *)(uintptr_t)(i + 1));
+			zz_stack_push(&frames, child);
+			zz_stack_push(&frames, zz_first_child(child));
+			zz_stack_push(&frames, (void *)0);
+			continue;
+		}
+		/* The copies of the ``i`` children of src are on top; their
+		 * parent takes over the references held on them */
+		built.size -= i;
+		copy = zz_node_shared(tree, src->token, copy_data(tree, src),
+				(struct zz_node **)built.data + built.size, i);
+		for (k = built.size; k < built.size + i; ++k)
+			zz_unref(built.data[k]);
+		zz_stack_push(&built, copy);
+	}
+	copy = zz_stack_pop(&built);
+	zz_stack_destroy(&frames);
+	zz_stack_destroy(&built);
+	return copy;
 }
 
 struct zz_node * zz_copy_recursive(struct zz_tree * tree, struct zz_node * node)
 {
-	struct zz_node *ret;
-	struct zz_node *iter;
+	struct zz_stack stack;
+	struct zz_node *ret, *src, *dst, *iter, *copy;
 
+	if (tree->flags & ZZ_TREE_SHARED)
+		return copy_shared(tree, node);
 	ret = zz_copy(tree, node);
 	if (ret == NULL)
 		return ret;
-	zz_list_foreach_entry(iter, &node->children, siblings)
-		zz_append_child(ret, zz_copy_recursive(tree, iter));
+	/* Pairs of original and copy whose children are still to be copied */
+	zz_stack_init(&stack);
+	zz_stack_push(&stack, node);
+	zz_stack_push(&stack, ret);
+	while (!zz_stack_empty(&stack)) {
+		dst = zz_stack_pop(&stack);
+		src = zz_stack_pop(&stack);
+		zz_foreach_child(iter, src) {
+			copy = zz_copy(tree, iter);
+			zz_append_child(dst, copy);
+			if (zz_first_child(iter) != NULL) {
+				zz_stack_push(&stack, iter);
+				zz_stack_push(&stack, copy);
+			}
+		}
+	}
+	zz_stack_destroy(&stack);
 	return ret;
 }
 
+
+/* Hash of node if known without walking its children, or 0 otherwise */
+static size_t known_hash(struct zz_node *n)
+{
+	if (zz_is_shared(n))
+		return ZZ_SHARED(n)->hash;
+	if (n->tree->flags & ZZ_TREE_HASHES)
+		return *zz_cached_hash(n);
+	return 0;
+}
+
+size_t zz_hash(struct zz_node *n)
+{
+	return zz_hash_each(n, NULL, NULL);
+}
+
+/* Like copy_shared(), with the hashes of the children on the second stack;
+ * children with a known hash are not walked */
+size_t zz_hash_each(struct zz_node *n,
+		void (*fn)(struct zz_node *, size_t, void *), void *data)
+{
+	struct zz_stack frames, hashes;
+	struct zz_node *src, *child;
+	size_t hash, i, k;
+
+	hash = known_hash(n);
+	if (hash != 0) {
+		if (fn != NULL)
+			fn(n, hash, data);
+		return hash;
+	}
+	zz_stack_init(&frames);
+	zz_stack_init(&hashes);
+	zz_stack_push(&frames, n);
+	zz_stack_push(&frames, zz_first_child(n));
+	zz_stack_push(&frames, (void *)0);
+	while (!zz_stack_empty(&frames)) {
+		i = (uintptr_t)zz_stack_pop(&frames);
+		child = zz_stack_pop(&frames);
+		src = zz_stack_pop(&frames);
+		if (child != NULL) {
+			zz_stack_push(&frames, src);
+			zz_stack_push(&frames, zz_next_child(src, child, i));
+			zz_stack_push(&frames, (void *)(uintptr_t)(i + 1));
+			hash = known_hash(child);
+			if (hash != 0) {
+				if (fn != NULL)
+					fn(child, hash, data);
+				zz_stack_push(&hashes, (void *)(uintptr_t)hash);
+				continue;
+			}
+			zz_stack_push(&frames, child);
+			zz_stack_push(&frames, zz_first_child(child));
+			zz_stack_push(&frames, (void *)0);
+			continue;
+		}
+		hash = hash_start(src->token, src->data);
+		for (k = hashes.size - i; k < hashes.size; ++k)
+			hash = hash_child(hash, (uintptr_t)hashes.data[k]);
+		hash = hash_end(hash);
+		hashes.size -= i;
+		if (src->tree->flags & ZZ_TREE_HASHES)
+			*zz_cached_hash(src) = hash;
+		if (fn != NULL)
+			fn(src, hash, data);
+		zz_stack_push(&hashes, (void *)(uintptr_t)hash);
+	}
+	zz_stack_destroy(&frames);
+	zz_stack_destroy(&hashes);
+	return hash;
+}
+
+/* Compare tokens and data, and hashes if known, but not children */
+static int node_equal(struct zz_node *a, struct zz_node *b)
+{
+	size_t ha, hb;
+
+	if (zz_is_shared(a) && b->tree == a->tree)
+		return a == b;
+	ha = known_hash(a);
+	hb = known_hash(b);
+	if (ha != 0 && hb != 0 && ha != hb)
+		return 0;
+	return a->token == b->token && zz_data_equal(a->data, b->data);
+}
+
+int zz_equal(struct zz_node *a, struct zz_node *b)
+{
+	struct zz_stack pairs;
+	struct zz_node *ca, *cb;
+	size_t i;
+	int equal = 1;
+
+	/* Pairs of nodes whose children are still to be compared */
+	zz_stack_init(&pairs);
+	if (a != b && node_equal(a, b)) {
+		zz_stack_push(&pairs, a);
+		zz_stack_push(&pairs, b);
+	} else {
+		equal = a == b;
+	}
+	while (equal && !zz_stack_empty(&pairs)) {
+		b = zz_stack_pop(&pairs);
+		a = zz_stack_pop(&pairs);
+		ca = zz_first_child(a);
+		cb = zz_first_child(b);
+		for (i = 0; ca != NULL && cb != NULL; ++i) {
+			if (ca != cb) {
+				if (!node_equal(ca, cb))
+					break;
+				zz_stack_push(&pairs, ca);
+				zz_stack_push(&pairs, cb);
+			}
+			ca = zz_next_child(a, ca, i);
+			cb = zz_next_child(b, cb, i);
+		}
+		equal = ca == NULL && cb == NULL;
+	}
+	zz_stack_destroy(&pairs);
+	return equal;
+}
+
+struct zz_node *zz_version(struct zz_node *root)
+{
+	return zz_ref(root);
+}
+
+void zz_version_release(struct zz_node *root)
+{
+	zz_unref(root);
+}
+
+/* Push the nodes on ``path`` from ``root``, both ends included, and return
+ * the last one */
+static struct zz_node *follow_path(struct zz_stack *nodes, struct zz_node *root,
+		const size_t *path, size_t depth)
+{
+	struct zz_node *n = root;
+	size_t i;
+
+	assert(zz_is_shared(root));
+	zz_stack_push(nodes, n);
+	for (i = 0; i < depth; ++i) {
+		n = zz_child(n, path[i]);
+		assert(n != NULL);
+		zz_stack_push(nodes, n);
+	}
+	return n;
+}
+
+/* Replace the node on top of ``nodes`` by ``n``, and each node under it by a
+ * copy whose child on the path is the replacement of the node above; takes
+ * over the reference held on ``n``, and returns one on the new root */
+static struct zz_node *copy_path(struct zz_stack *nodes, const size_t *path,
+		struct zz_node *n)
+{
+	struct zz_stack children;
+	struct zz_node *p;
+	size_t depth = nodes->size - 1, i;
+
+	zz_stack_init(&children);
+	while (depth-- > 0) {
+		zz_stack_pop(nodes);
+		p = zz_stack_top(nodes);
+		children.size = 0;
+		for (i = 0; i < ZZ_SHARED(p)->child_count; ++i)
+			zz_stack_push(&children, ZZ_SHARED(p)->children[i]);
+		children.data[path[depth]] = n;
+		p = zz_node_shared(p->tree, p->token, copy_data(p->tree, p),
+				(struct zz_node **)children.data, children.size);
+		zz_unref(n);
+		n = p;
+	}
+	zz_stack_destroy(&children);
+	zz_stack_destroy(nodes);
+	return n;
+}
+
+struct zz_node *zz_version_node(struct zz_node *root, const size_t *path,
+		size_t depth)
+{
+	size_t i;
+
+	for (i = 0; root != NULL && i < depth; ++i)
+		root = zz_child(root, path[i]);
+	return root;
+}
+
+struct zz_node *zz_version_replace(struct zz_node *root, const size_t *path,
+		size_t depth, struct zz_node *n)
+{
+	struct zz_stack nodes;
+
+	assert(n->tree == root->tree);
+	zz_stack_init(&nodes);
+	follow_path(&nodes, root, path, depth);
+	return copy_path(&nodes, path, zz_ref(n));
+}
+
+struct zz_node *zz_version_set_data(struct zz_node *root, const size_t *path,
+		size_t depth, struct zz_data data)
+{
+	struct zz_stack nodes;
+	struct zz_node *n;
+
+	zz_stack_init(&nodes);
+	n = follow_path(&nodes, root, path, depth);
+	n = zz_node_shared(n->tree, n->token, data, ZZ_SHARED(n)->children,
+			ZZ_SHARED(n)->child_count);
+	return copy_path(&nodes, path, n);
+}
+
+struct zz_node *zz_version_insert(struct zz_node *root, const size_t *path,
+		size_t depth, size_t index, struct zz_node *child)
+{
+	struct zz_stack nodes, children;
+	struct zz_node *n;
+	size_t i;
+
+	assert(child->tree == root->tree);
+	zz_stack_init(&nodes);
+	n = follow_path(&nodes, root, path, depth);
+	assert(index <= ZZ_SHARED(n)->child_count);
+	zz_stack_init(&children);
+	for (i = 0; i <= ZZ_SHARED(n)->child_count; ++i) {
+		if (i == index)
+			zz_stack_push(&children, child);
+		if (i < ZZ_SHARED(n)->child_count)
+			zz_stack_push(&children, ZZ_SHARED(n)->children[i]);
+	}
+	n = zz_node_shared(n->tree, n->token, copy_data(n->tree, n),
+			(struct zz_node **)children.data, children.size);
+	zz_stack_destroy(&children);
+	return copy_path(&nodes, path, n);
+}
+
+struct zz_node *zz_version_remove(struct zz_node *root, const size_t *path,
+		size_t depth, size_t index)
+{
+	struct zz_stack nodes, children;
+	struct zz_node *n;
+	size_t i;
+
+	zz_stack_init(&nodes);
+	n = follow_path(&nodes, root, path, depth);
+	assert(index < ZZ_SHARED(n)->child_count);
+	zz_stack_init(&children);
+	for (i = 0; i < ZZ_SHARED(n)->child_count; ++i) {
+		if (i != index)
+			zz_stack_push(&children, ZZ_SHARED(n)->children[i]);
+	}
+	n = zz_node_shared(n->tree, n->token, copy_data(n->tree, n),
+			(struct zz_node **)children.data, children.size);
+	zz_stack_destroy(&children);
+	return copy_path(&nodes, path, n);
+}
@@ -3,7 +3,10 @@
 #ifndef ZEBU_TREE_H_
 #define ZEBU_TREE_H_
 
-#include "node.h"
+#include "list.h"
+#include "data.h"
+#include "arena.h"
+#include "dict.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -14,43 +17,337 @@ extern "C" {
  * ----
  */
 
+struct zz_node;
+struct zz_tokens;
+
+/* Shared nodes with fewer children than this are recycled through a free list
+ * for each number of children; larger ones are allocated one by one */
+#define ZZ_SHARED_FREE_LISTS 8
+
 /**
  * Abstract Syntax Tree
  *
  * Not actually the tree, but a factory to produce new nodes that can
  * deallocate all them with a sigle call.
+ *
+ * Nodes are carved out of the chunks of an arena; destroyed nodes are kept in
+ * a free list and recycled by the next call to zz_node().
+ *
+ * A tree created with the ``ZZ_TREE_STRING_POOL`` flag owns a string pool:
+ * strings created with zz_tree_string() are interned in it instead of the
+ * dictionary shared by the whole process, allocated from an arena, and
+ * released all at once by zz_tree_destroy(). Such strings must not outlive
+ * the tree.
+ *
+ * A tree created with the ``ZZ_TREE_INLINE_STRINGS`` flag stores strings
+ * created with zz_tree_string() inline in the data when they are short enough,
+ * instead of interning them.
+ *
+ * A tree created with the ``ZZ_TREE_COMPACT`` flag uses the smaller layout of
+ * ``zz_compact_node`` for its nodes. Its live nodes are found by walking the
+ * chunks of the arena, where destroyed nodes have a ``NULL`` tree, instead of
+ * through a list.
+ *
+ * A tree created with the ``ZZ_TREE_PARENTS`` flag keeps a ``zz_node_links``
+ * in front of each of its nodes, with the parent and number of children of
+ * the node, so that zz_parent() and zz_child_count() take constant time, and
+ * zz_child() resumes from the last child it returned.
+ *
+ * A tree created with the ``ZZ_TREE_TOKEN_INDEX`` flag keeps a list of its
+ * nodes for each token, through a ``zz_list`` in front of each node, so that
+ * finding the nodes of a token takes time proportional to their number. Their
+ * tokens must come from the ``zz_tokens`` registry given to
+ * zz_tree_set_tokens() before the first node is created.
+ *
+ * A tree created with the ``ZZ_TREE_SHARED`` flag hash-conses its nodes: they
+ * use the layout of ``zz_shared_node``, are created with all their children by
+ * zz_node_shared(), and never change, so that creating a node equal to an
+ * existing one, with the same token, equal data and the same children, returns
+ * the existing one. Their node size must be that of ``zz_shared_node``, since
+ * nothing else would be compared. Identical subtrees are then stored once, and
+ * are equal if and only if they are the same node. A node may have any number
+ * of parents, so a subtree is used in several places by making it the child of
+ * each instead of copying it; this is the only kind of tree where nodes can be
+ * shared. Nodes of other trees have a single parent and a single owner:
+ * zz_append_child() asserts that the child has no parent where it can tell,
+ * and zz_unref() on them is zz_destroy(). Nodes count their references: every
+ * function that returns a shared node, even one that already existed, gives
+ * the caller a reference, that zz_unref() drops, and each parent holds one on
+ * each of its children. A node is freed when its last reference is dropped;
+ * nodes whose references are never dropped live until the tree is reset or
+ * destroyed. zz_destroy() does nothing on shared nodes. The flag can't be
+ * combined with ``ZZ_TREE_COMPACT``, ``ZZ_TREE_PARENTS`` or
+ * ``ZZ_TREE_TOKEN_INDEX``.
+ *
+ * A tree created with the ``ZZ_TREE_HASHES`` flag caches the result of
+ * zz_hash() in front of each of its nodes, so that hashing a subtree again
+ * takes constant time until it changes. Functions that change a node forget
+ * the hashes of the node and its ancestors, so the flag needs
+ * ``ZZ_TREE_PARENTS``; changing ``data`` directly leaves them stale.
+ *
+ * All memory owned by the tree comes from a ``zz_allocator``, that must
+ * outlive it.
  */
 struct zz_tree {
 	size_t node_size;
+	unsigned int flags;
 	struct zz_list nodes;
+	struct zz_list free_nodes;
+	struct zz_node *free_compact;
+	struct zz_arena arena;
+	struct zz_dict *strings;
+	struct zz_arena string_arena;
+	const struct zz_allocator *allocator;
+	size_t node_count;
+	size_t peak_node_count;
+	size_t node_bytes;
+	size_t peak_node_bytes;
+	size_t allocated;
+	size_t string_hits;
+	size_t string_misses;
+	const struct zz_tokens *tokens;
+	struct zz_list *token_index;
+	size_t token_index_size;
+	struct zz_node **shared;
+	size_t shared_size;
+	size_t shared_count;
+	struct zz_node *shared_free[ZZ_SHARED_FREE_LISTS];
+};
+
+/**
+ * Statistics about a tree
+ */
+struct zz_tree_stats {
+	/** Nodes currently allocated */
+	size_t nodes;
+	/** Highest number of nodes allocated at the same time */
+	size_t peak_nodes;
+	/** Bytes used by the nodes currently allocated */
+	size_t node_bytes;
+	/** Highest number of bytes used by nodes at the same time */
+	size_t peak_node_bytes;
+	/** Bytes obtained from the allocator for nodes, pooled strings and the
+	 * tables of the tree */
+	size_t allocated;
+	/** String pool; all zeros if the tree doesn't have one */
+	struct zz_dict_stats strings;
 };
 
+/**
+ * Flags for zz_tree_init_flags()
+ */
+enum zz_tree_flags {
+	ZZ_TREE_STRING_POOL = 1 << 0,
+	ZZ_TREE_COMPACT = 1 << 1,
+	ZZ_TREE_PARENTS = 1 << 2,
+	ZZ_TREE_TOKEN_INDEX = 1 << 3,
+	ZZ_TREE_INLINE_STRINGS = 1 << 4,
+	ZZ_TREE_SHARED = 1 << 5,
+	ZZ_TREE_HASHES = 1 << 6,
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+/* Nodes look at the flags of their tree to find out their layout, so the tree
+ * must be defined first */
+#include "node.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
  * Initialize tree 
  */
 void zz_tree_init(struct zz_tree *tree, size_t node_size);
+/**
+ * Initialize tree with a combination of ``zz_tree_flags``
+ */
+void zz_tree_init_flags(struct zz_tree *tree, size_t node_size, unsigned int flags);
+/**
+ * Initialize tree with a combination of ``zz_tree_flags``, to get its memory
+ * from ``allocator``
+ */
+void zz_tree_init_allocator(struct zz_tree *tree, size_t node_size,
+		unsigned int flags, const struct zz_allocator *allocator);
 /**
  * Destroy tree 
  */
 void zz_tree_destroy(struct zz_tree *tree);
 
+/**
+ * Destroy all nodes and pooled strings, but keep the memory they used to
+ * create new ones; the tree can be filled again as if it had just been
+ * initialized, without allocating memory until it grows larger than before.
+ * The data of every live node is released, since it may hold strings that
+ * are not pooled, so this takes time proportional to the number of nodes (to
+ * the slots of the arena in compact trees), but frees no chunks. The counters
+ * of zz_tree_stats(), peaks included, start over.
+ */
+void zz_tree_reset(struct zz_tree *tree);
+
+/**
+ * Reserve memory for ``count`` nodes, so that creating them needs no further
+ * allocations
+ */
+void zz_tree_reserve(struct zz_tree *tree, size_t count);
+/**
+ * Get statistics about the tree; counters are always kept up to date, only
+ * the depth of the string pool is computed on demand
+ */
+void zz_tree_stats(const struct zz_tree *tree, struct zz_tree_stats *stats);
+
+/**
+ * Set the registry of the tokens of a tree created with
+ * ``ZZ_TREE_TOKEN_INDEX``; it must outlive the tree
+ */
+void zz_tree_set_tokens(struct zz_tree *tree, const struct zz_tokens *tokens);
+/**
+ * Get the first node of a tree created with ``ZZ_TREE_TOKEN_INDEX`` whose
+ * token is ``token``, and the next one with the same token as ``n``, or
+ * ``NULL`` if there isn't one; nodes are found in the order they were created,
+ * and there are none for tokens that are not in the registry of the tree
+ */
+struct zz_node *zz_tree_first_of(struct zz_tree *tree, const char *token);
+struct zz_node *zz_tree_next_of(struct zz_node *n);
+/**
+ * Iterate on the nodes of a tree whose token is ``token``; nodes other than
+ * ``iter`` may be destroyed inside the loop
+ */
+#define zz_tree_foreach_of(iter, tree, token) \
+for (iter = zz_tree_first_of(tree, token); iter != NULL; \
+		iter = zz_tree_next_of(iter))
+
+/**
+ * Create string data; interned in the pool of the tree if it has one, or in
+ * the global dictionary otherwise
+ */
+struct zz_data zz_tree_string(struct zz_tree *tree, const char *str);
+/**
+ * Create string data from the first ``length`` characters of ``str``, that
+ * need not be NUL-terminated; same as zz_tree_string() otherwise
+ */
+struct zz_data zz_tree_string_n(struct zz_tree *tree, const char *str, size_t length);
+
 /**
  * Create a node 
  */
 struct zz_node *zz_node(struct zz_tree *tree, const char *tok, struct zz_data data);
 /**
- * Destroy a node 
+ * Create a node of a tree created with ``ZZ_TREE_SHARED``, whose children are
+ * the ``count`` nodes of ``children``, or get the existing node with the same
+ * token, equal data and the same children; in that case ``data`` is
+ * destroyed. Either way the caller gets a reference to the node, and the
+ * node one to each of its children, which the caller keeps its own
+ * references to. Children must be nodes of the same tree.
+ */
+struct zz_node *zz_node_shared(struct zz_tree *tree, const char *tok,
+		struct zz_data data, struct zz_node *const *children, size_t count);
+/**
+ * Take one more reference to ``n``, a node of a tree created with
+ * ``ZZ_TREE_SHARED``, and return it
+ */
+struct zz_node *zz_ref(struct zz_node *n);
+/**
+ * Drop a reference to a shared node, that the caller got from the function
+ * that returned the node or from zz_ref(), and free the node when it was the
+ * last one; its children lose a reference in turn, so the nodes of the
+ * subtree that nothing else holds are freed with it. Nodes of other trees have
+ * a single owner, so their subtree is destroyed as with zz_destroy().
  */
 void zz_unref(struct zz_node *n);
+
+/**
+ * Return 1 if the subtrees of ``a`` and ``b`` are equal, with the same tokens
+ * and equal data (see zz_data_equal()) in the same places, and 0 otherwise.
+ * Subtrees with known, different hashes are told apart in constant time, and
+ * nodes of the same shared tree are equal only if they are the same node.
+ */
+int zz_equal(struct zz_node *a, struct zz_node *b);
+/**
+ * Hash of the subtree of ``n``, from the address of its tokens, its data and
+ * its shape; equal subtrees have equal hashes, wherever they are. Takes
+ * constant time for shared nodes and for nodes with a cached hash.
+ */
+size_t zz_hash(struct zz_node *n);
+/**
+ * Same as zz_hash(), calling ``fn`` with each node, its hash and ``data``,
+ * children before their parent; the descendants of nodes with a known hash
+ * are skipped
+ */
+size_t zz_hash_each(struct zz_node *n,
+		void (*fn)(struct zz_node *, size_t, void *), void *data);
 /**
  * Copy a node 
  */
 struct zz_node *zz_copy(struct zz_tree *tree, struct zz_node *node);
 /**
- * Copy a node and all its children recursively 
+ * Copy a node and all its children recursively; copies into a tree created
+ * with ``ZZ_TREE_SHARED`` are built from the leaves up, and share the
+ * subtrees that repeat
  */
 struct zz_node *zz_copy_recursive(struct zz_tree *tree, struct zz_node *node);
 
+/**
+ * Versions
+ * --------
+ *
+ * Persistent versions of a tree created with ``ZZ_TREE_SHARED``. A version is
+ * a reference to a root node, such as the one returned by zz_copy_recursive()
+ * or by the functions below; changing a node of a version gives a new
+ * version, where the node and its ancestors are new nodes and every other
+ * subtree is shared with the old version, so a change costs the children of
+ * the nodes on its path rather than a copy of the whole tree. Nodes are named
+ * by their path, the indices of the children to follow from the root, of
+ * length ``depth``.
+ *
+ * Releasing a version frees the nodes that no other version, nor any other
+ * reference, reaches, whatever the order in which versions are released.
+ */
+
+/**
+ * Take another version handle on ``root``; same as zz_ref()
+ */
+struct zz_node *zz_version(struct zz_node *root);
+/**
+ * Release a version handle; same as zz_unref(). Its nodes must not be used
+ * afterwards unless another version reaches them.
+ */
+void zz_version_release(struct zz_node *root);
+/**
+ * Get the node at ``path`` in ``root``, or ``NULL`` if there isn't one
+ */
+struct zz_node *zz_version_node(struct zz_node *root, const size_t *path,
+		size_t depth);
+/**
+ * Return a new version of ``root`` where the node at ``path`` is replaced by
+ * ``n``, a node of the same tree; ``root`` is left as it was, and the caller
+ * keeps its reference to ``n``
+ */
+struct zz_node *zz_version_replace(struct zz_node *root, const size_t *path,
+		size_t depth, struct zz_node *n);
+/**
+ * Return a new version of ``root`` where the node at ``path`` has ``data``
+ * instead of its own
+ */
+struct zz_node *zz_version_set_data(struct zz_node *root, const size_t *path,
+		size_t depth, struct zz_data data);
+/**
+ * Return a new version of ``root`` where ``child`` is inserted as child
+ * ``index`` of the node at ``path``; ``index`` may be its number of
+ * children, and the caller keeps its reference to ``child``
+ */
+struct zz_node *zz_version_insert(struct zz_node *root, const size_t *path,
+		size_t depth, size_t index, struct zz_node *child);
+/**
+ * Return a new version of ``root`` where child ``index`` of the node at
+ * ``path`` is removed
+ */
+struct zz_node *zz_version_remove(struct zz_node *root, const size_t *path,
+		size_t depth, size_t index);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,65 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#include "view.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Check that a table fits in the file */
+static int check_table(uint64_t size, uint64_t offset, uint32_t count)
+{
+	return offset % 8 == 0 && offset <= size &&
+		(size - offset) / sizeof(struct zz_file_string) >= count;
+}
+
+int zz_view_open(struct zz_view *v, const char *path)
+{
+	const struct zz_file_header *h;
+	struct stat st;
+	void *base;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(*h)) {
+		close(fd);
+		return -1;
+	}
+	base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED)
+		return -1;
+
+	h = base;
+	if (memcmp(h->magic, ZZ_FILE_MAGIC, sizeof(h->magic)) != 0 ||
+			h->version != ZZ_FILE_VERSION || h->byte_order != 1 ||
+			h->node_count == 0 ||
+			h->node_stride < sizeof(struct zz_file_node) + h->ext_size ||
+			h->node_stride % 8 != 0 ||
+			h->file_size > (uint64_t)st.st_size ||
+			h->nodes_offset % 8 != 0 || h->nodes_offset > h->file_size ||
+			(h->file_size - h->nodes_offset) / h->node_stride < h->node_count ||
+			!check_table(h->file_size, h->tokens_offset, h->token_count) ||
+			!check_table(h->file_size, h->strings_offset, h->string_count)) {
+		munmap(base, st.st_size);
+		return -1;
+	}
+
+	v->base = base;
+	v->size = st.st_size;
+	v->header = h;
+	v->tokens = (const struct zz_file_string *)(v->base + h->tokens_offset);
+	v->strings = (const struct zz_file_string *)(v->base + h->strings_offset);
+	return 0;
+}
+
+void zz_view_close(struct zz_view *v)
+{
+	munmap((void *)v->base, v->size);
+	v->base = NULL;
+	v->size = 0;
+}
@@ -0,0 +1,178 @@
+/* Copyright 2017 Luis Sanz <luis.sanz@gmail.com> */
+
+#ifndef ZEBU_VIEW_H_
+#define ZEBU_VIEW_H_
+
+#include "serial.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * View
+ * ----
+ *
+ * Read-only view of a tree saved by zz_tree_save(), mapped in memory.
+ *
+ * Opening a view only checks the header of the file; pages are read as nodes
+ * are accessed. Nodes are identified by their index in preorder, so the root
+ * is always 0, and 0 also stands for "no node" where a child or sibling is
+ * expected. Tokens and strings point into the mapped file, and are valid until
+ * the view is closed.
+ *
+ * Records are checked as they are accessed: indices out of range behave as
+ * missing nodes, and tokens or strings out of range, or that don't end in a
+ * NUL inside the file, as ``NULL``.
+ */
+
+/**
+ * Mapped file
+ */
+struct zz_view {
+	const char *base;
+	size_t size;
+	const struct zz_file_header *header;
+	const struct zz_file_string *tokens;
+	const struct zz_file_string *strings;
+};
+
+/**
+ * Map the file at ``path``; returns 0 on success, or -1 if it can't be mapped
+ * or is not a tree
+ */
+int zz_view_open(struct zz_view *v, const char *path);
+/**
+ * Unmap the file
+ */
+void zz_view_close(struct zz_view *v);
+
+/**
+ * Number of nodes
+ */
+static inline size_t zz_view_count(const struct zz_view *v)
+{
+	return v->header->node_count;
+}
+/**
+ * Get record of node ``n``
+ */
+static inline const struct zz_file_node *zz_view_record(const struct zz_view *v, size_t n)
+{
+	return (const struct zz_file_node *)(v->base + v->header->nodes_offset +
+			n * v->header->node_stride);
+}
+/**
+ * Get root node, first child and next sibling of node, or 0 if there isn't
+ * one
+ */
+static inline size_t zz_view_root(const struct zz_view *v)
+{
+	return 0;
+}
+static inline size_t zz_view_first_child(const struct zz_view *v, size_t n)
+{
+	if (zz_view_record(v, n)->child_count == 0 || n + 1 >= zz_view_count(v))
+		return 0;
+	return n + 1;
+}
+static inline size_t zz_view_next_sibling(const struct zz_view *v, size_t n)
+{
+	size_t next = zz_view_record(v, n)->next;
+	if (next <= n || next >= zz_view_count(v))
+		return 0;
+	return next;
+}
+/**
+ * Number of children of node
+ */
+static inline size_t zz_view_child_count(const struct zz_view *v, size_t n)
+{
+	return zz_view_record(v, n)->child_count;
+}
+/**
+ * Iterate on children of node
+ */
+#define zz_view_foreach_child(iter, v, n) \
+for (iter = zz_view_first_child(v, n); iter != 0; \
+		iter = zz_view_next_sibling(v, iter))
+/**
+ * String of an entry of the token or string table, or ``NULL`` if it isn't
+ * a NUL-terminated string inside the file
+ */
+static inline const char *zz_view_entry(const struct zz_view *v,
+		const struct zz_file_string *e)
+{
+	uint64_t size = v->header->file_size;
+	if (e->offset >= size || e->length >= size - e->offset ||
+			v->base[e->offset + e->length] != '\0')
+		return NULL;
+	return v->base + e->offset;
+}
+/**
+ * Name of the token of node
+ */
+static inline const char *zz_view_token(const struct zz_view *v, size_t n)
+{
+	uint32_t i = zz_view_record(v, n)->token;
+	if (i >= v->header->token_count)
+		return NULL;
+	return zz_view_entry(v, &v->tokens[i]);
+}
+/**
+ * Type of payload of node
+ */
+static inline enum zz_data_type zz_view_type(const struct zz_view *v, size_t n)
+{
+	return (enum zz_data_type)zz_view_record(v, n)->type;
+}
+/**
+ * Get payload of node as a specific type
+ */
+static inline int zz_view_int(const struct zz_view *v, size_t n)
+{
+	assert(zz_view_type(v, n) == ZZ_INT);
+	return zz_view_record(v, n)->data.int_val;
+}
+static inline unsigned int zz_view_uint(const struct zz_view *v, size_t n)
+{
+	assert(zz_view_type(v, n) == ZZ_UINT);
+	return zz_view_record(v, n)->data.uint_val;
+}
+static inline double zz_view_double(const struct zz_view *v, size_t n)
+{
+	assert(zz_view_type(v, n) == ZZ_DOUBLE);
+	return zz_view_record(v, n)->data.double_val;
+}
+static inline const char *zz_view_string(const struct zz_view *v, size_t n)
+{
+	uint64_t i;
+	assert(zz_view_type(v, n) == ZZ_STRING);
+	i = zz_view_record(v, n)->data.string_val;
+	if (i >= v->header->string_count)
+		return NULL;
+	return zz_view_entry(v, &v->strings[i]);
+}
+static inline size_t zz_view_string_length(const struct zz_view *v, size_t n)
+{
+	uint64_t i;
+	assert(zz_view_type(v, n) == ZZ_STRING);
+	i = zz_view_record(v, n)->data.string_val;
+	if (i >= v->header->string_count ||
+			zz_view_entry(v, &v->strings[i]) == NULL)
+		return 0;
+	return v->strings[i].length;
+}
+/**
+ * Get the user extension bytes of node
+ */
+static inline const void *zz_view_ext(const struct zz_view *v, size_t n)
+{
+	return zz_view_record(v, n) + 1;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif       // ZEBU_VIEW_H_
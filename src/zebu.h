@@ -5,5 +5,10 @@
 
 #include "tree.h"
 #include "print.h"
+#include "serial.h"
+#include "view.h"
+#include "frozen.h"
+#include "token.h"
+#include "diff.h"
 
 #endif       // ZEBU_H_
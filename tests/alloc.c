@@ -99,6 +99,26 @@ int allocate_many_strings(void)
 		snprintf(buf, sizeof(buf), "%zu", i);
 		assert(strcmp(zz_get_string(nodes[i]), buf) == 0);
 	}
+	free(nodes);
+	zz_tree_destroy(&tree);
+	return 0;
+}
+
+/* Destroyed nodes must be recycled by the tree */
+int recycle_nodes(void)
+{
+	struct zz_tree tree;
+	struct zz_node *n1, *n2, *n3;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	n1 = zz_node(&tree, TOK_FOO, zz_string("foo"));
+	n2 = zz_node(&tree, TOK_BAR, zz_null);
+	zz_append_child(n1, n2);
+	zz_destroy(n1);
+	n3 = zz_node(&tree, TOK_BAZ, zz_null);
+	assert(n3 == n1 || n3 == n2);
+	assert(zz_first_child(n3) == NULL);
+	assert(zz_is_null(n3));
 	zz_tree_destroy(&tree);
 	return 0;
 }
@@ -107,5 +127,6 @@ int main(int argc, char *argv[])
 {
 	allocate_huge_string();
 	allocate_many_strings();
+	recycle_nodes();
 }
 
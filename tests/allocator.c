@@ -0,0 +1,120 @@
+/*
+ * Test for custom allocators
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+
+static const char *TOK_FOO = "foo";
+static const char *TOK_BAR = "bar";
+
+/* Allocator that keeps track of live memory */
+struct counter {
+	size_t allocs;
+	size_t frees;
+	size_t bytes;
+};
+
+static void *counter_alloc(void *data, size_t size)
+{
+	struct counter *c = data;
+	++c->allocs;
+	c->bytes += size;
+	return malloc(size);
+}
+
+static void counter_free(void *data, void *ptr, size_t size)
+{
+	struct counter *c = data;
+	++c->frees;
+	c->bytes -= size;
+	free(ptr);
+}
+
+/* Allocator that releases everything at once */
+struct region {
+	void **blocks;
+	size_t count;
+	size_t frees;
+	size_t releases;
+};
+
+static void *region_alloc(void *data, size_t size)
+{
+	struct region *r = data;
+	r->blocks = realloc(r->blocks, (r->count + 1) * sizeof(*r->blocks));
+	return r->blocks[r->count++] = malloc(size);
+}
+
+static void region_free(void *data, void *ptr, size_t size)
+{
+	struct region *r = data;
+	++r->frees;
+}
+
+static void region_release(void *data)
+{
+	struct region *r = data;
+	while (r->count > 0)
+		free(r->blocks[--r->count]);
+	free(r->blocks);
+	r->blocks = NULL;
+	++r->releases;
+}
+
+static void build(struct zz_tree *tree)
+{
+	struct zz_node *root;
+	char buf[32];
+	int i;
+
+	root = zz_node(tree, TOK_FOO, zz_null);
+	for (i = 0; i < 1000; ++i) {
+		snprintf(buf, sizeof(buf), "%d", i);
+		zz_append_child(root, zz_node(tree, TOK_BAR,
+					zz_tree_string(tree, buf)));
+	}
+	zz_append_child(root, zz_node(tree, TOK_BAR, zz_string("foo")));
+	assert(strcmp(zz_get_string(zz_last_child(root)), "foo") == 0);
+	assert(strcmp(zz_get_string(zz_first_child(root)), "0") == 0);
+}
+
+void count_allocations(void)
+{
+	struct counter c = { 0 };
+	struct zz_allocator a = { counter_alloc, counter_free, NULL, &c };
+	struct zz_tree tree;
+
+	zz_tree_init_allocator(&tree, sizeof(struct zz_node),
+			ZZ_TREE_STRING_POOL, &a);
+	build(&tree);
+	assert(c.allocs > 0);
+	assert(c.bytes > 1000 * sizeof(struct zz_node));
+	zz_tree_destroy(&tree);
+	assert(c.frees == c.allocs);
+	assert(c.bytes == 0);
+}
+
+void release_at_once(void)
+{
+	struct region r = { 0 };
+	struct zz_allocator a = { region_alloc, region_free, region_release, &r };
+	struct zz_tree tree;
+
+	zz_tree_init_allocator(&tree, sizeof(struct zz_node),
+			ZZ_TREE_STRING_POOL, &a);
+	build(&tree);
+	assert(r.count > 0);
+	zz_tree_destroy(&tree);
+	assert(r.releases == 1);
+	assert(r.count == 0);
+}
+
+int main(int argc, char *argv[])
+{
+	count_allocations();
+	release_at_once();
+	exit(EXIT_SUCCESS);
+}
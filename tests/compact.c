@@ -0,0 +1,162 @@
+/*
+ * Test for trees with the compact node layout
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+
+struct compact_with_location {
+	struct zz_compact_node node;
+	int location;
+};
+
+static const char *TOK_FOO = "foo";
+static const char *TOK_BAR = "bar";
+static const char *TOK_BAZ = "baz";
+
+static const char *const TOKENS[] = { "foo", "bar", "baz" };
+
+static struct zz_node *build(struct zz_tree *tree)
+{
+	struct zz_node *root, *n;
+	int i;
+
+	root = zz_node(tree, TOK_FOO, zz_null);
+	zz_append_child(root, zz_node(tree, TOK_BAR, zz_int(1)));
+	zz_append_child(root, zz_node(tree, TOK_BAR, zz_int(2)));
+	zz_prepend_child(root, zz_node(tree, TOK_BAR, zz_int(0)));
+	n = zz_node(tree, TOK_BAZ, zz_string("baz"));
+	zz_append_child(root, n);
+	zz_prepend_child(n, zz_node(tree, TOK_FOO, zz_tree_string(tree, "a")));
+	zz_append_child(n, zz_node(tree, TOK_FOO, zz_uint(3)));
+	i = 0;
+	zz_foreach_child(n, root)
+		((struct compact_with_location *)n)->location = ++i;
+	return root;
+}
+
+void navigate(void)
+{
+	struct zz_tree tree;
+	struct zz_node *root, *n, *m, *tmp;
+	int i;
+
+	zz_tree_init_flags(&tree, sizeof(struct compact_with_location),
+			ZZ_TREE_COMPACT);
+	assert(tree.node_size < sizeof(struct zz_node));
+	root = build(&tree);
+	assert(zz_is_compact(root));
+	zz_print(root, stdout);
+	printf("\n");
+
+	n = zz_first_child(root);
+	assert(zz_get_int(n) == 0);
+	assert(zz_prev_sibling(root, n) == NULL);
+	n = zz_next_sibling(root, n);
+	assert(zz_get_int(n) == 1);
+	assert(zz_get_int(zz_prev_sibling(root, n)) == 0);
+	n = zz_last_child(root);
+	assert(strcmp(zz_get_string(n), "baz") == 0);
+	assert(zz_next_sibling(root, n) == NULL);
+	i = 4;
+	zz_reverse_foreach_child(m, root)
+		assert(((struct compact_with_location *)m)->location == i--);
+	assert(i == 0);
+
+	/* Remove last, middle, first and only children */
+	zz_remove_child(root, n);
+	zz_destroy(n);
+	assert(zz_get_int(zz_last_child(root)) == 2);
+	zz_foreach_child_safe(n, tmp, root) {
+		if (zz_get_int(n) == 1) {
+			zz_remove_child(root, n);
+			zz_destroy(n);
+		}
+	}
+	n = zz_first_child(root);
+	zz_remove_child(root, n);
+	zz_destroy(n);
+	n = zz_first_child(root);
+	assert(n == zz_last_child(root));
+	assert(zz_get_int(n) == 2);
+	zz_remove_child(root, n);
+	zz_destroy(n);
+	assert(zz_first_child(root) == NULL);
+	assert(zz_last_child(root) == NULL);
+
+	/* Destroyed nodes are recycled */
+	n = zz_node(&tree, TOK_BAR, zz_int(4));
+	zz_append_child(root, n);
+	assert(zz_first_child(root) == n);
+	zz_tree_destroy(&tree);
+}
+
+void copy_save_and_load(void)
+{
+	struct zz_tree full, compact, loaded;
+	struct zz_node *root, *copy, *n, *m;
+	FILE *f;
+
+	zz_tree_init_flags(&compact, sizeof(struct compact_with_location),
+			ZZ_TREE_COMPACT | ZZ_TREE_STRING_POOL);
+	zz_tree_init(&full, sizeof(struct zz_node));
+	root = build(&compact);
+
+	copy = zz_copy_recursive(&full, root);
+	zz_print(copy, stdout);
+	printf("\n");
+	root = zz_copy_recursive(&compact, copy);
+	zz_print(root, stdout);
+	printf("\n");
+
+	zz_tree_init_flags(&loaded, sizeof(struct compact_with_location),
+			ZZ_TREE_COMPACT);
+	f = tmpfile();
+	assert(zz_tree_save(build(&compact), f) == 0);
+	rewind(f);
+	n = zz_tree_load(&loaded, f, TOKENS, 3);
+	fclose(f);
+	zz_print(n, stdout);
+	printf("\n");
+	m = zz_last_child(n);
+	assert(((struct compact_with_location *)m)->location == 4);
+
+	zz_tree_reset(&compact);
+	assert(compact.node_count == 0);
+	root = build(&compact);
+	zz_print(root, stdout);
+	printf("\n");
+
+	zz_tree_destroy(&loaded);
+	zz_tree_destroy(&full);
+	zz_tree_destroy(&compact);
+}
+
+void deep(void)
+{
+	struct zz_tree tree;
+	struct zz_node *root, *n, *c;
+	size_t i;
+
+	zz_tree_init_flags(&tree, sizeof(struct zz_compact_node), ZZ_TREE_COMPACT);
+	root = n = zz_node(&tree, TOK_FOO, zz_null);
+	for (i = 0; i < 100000; ++i) {
+		c = zz_node(&tree, TOK_BAR, zz_string("deep"));
+		zz_append_child(n, c);
+		zz_append_child(n, zz_node(&tree, TOK_BAZ, zz_int(i)));
+		n = c;
+	}
+	zz_destroy(root);
+	assert(tree.node_count == 0);
+	zz_tree_destroy(&tree);
+}
+
+int main(int argc, char *argv[])
+{
+	navigate();
+	copy_save_and_load();
+	deep();
+	exit(EXIT_SUCCESS);
+}
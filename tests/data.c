@@ -6,7 +6,7 @@
 
 int main(int argc, char *argv[])
 {
-	struct zz_data d;
+	struct zz_data d, e;
 
 	d = zz_null;
 	assert(d.type == ZZ_NULL);
@@ -22,6 +22,23 @@ int main(int argc, char *argv[])
 
 	d = zz_string("forty-two");
 	assert(strcmp(zz_to_string(d), "forty-two") == 0);
+	assert(zz_string_length(d) == 9);
+
+	e = zz_string_n("forty-two-three", 9);
+	assert(zz_to_string(e) == zz_to_string(d));
+	assert(zz_string_length(e) == 9);
+	zz_data_destroy(e);
+
+	e = zz_string_n("forty-two-three", 5);
+	assert(strcmp(zz_to_string(e), "forty") == 0);
+	assert(zz_string_length(e) == 5);
+	zz_data_destroy(e);
+
+	e = zz_string_n("", 0);
+	assert(strcmp(zz_to_string(e), "") == 0);
+	assert(zz_string_length(e) == 0);
+	zz_data_destroy(e);
+	zz_data_destroy(d);
 
 	d = zz_pointer(&d);
 	assert(zz_to_pointer(d) == &d);
@@ -0,0 +1,90 @@
+/*
+ * Test for trees too deep to be walked recursively
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+
+#define DEPTH 1000000
+
+static const char *TOK_FOO = "foo";
+static const char *TOK_BAR = "bar";
+
+/* A left-recursive chain, like the ones built for long statement lists */
+static struct zz_node *chain(struct zz_tree *tree, size_t depth)
+{
+	struct zz_node *root, *n, *c;
+	size_t i;
+
+	root = n = zz_node(tree, TOK_FOO, zz_null);
+	for (i = 1; i < depth; ++i) {
+		c = zz_node(tree, TOK_FOO, zz_null);
+		zz_append_child(n, c);
+		zz_append_child(n, zz_node(tree, TOK_BAR, zz_int(i)));
+		n = c;
+	}
+	return root;
+}
+
+void copy_chain(void)
+{
+	struct zz_tree tree;
+	struct zz_node *n1, *n2;
+	size_t i;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	n1 = chain(&tree, DEPTH);
+	n2 = zz_copy_recursive(&tree, n1);
+	for (i = 1; i < DEPTH; ++i) {
+		assert(n2 != n1);
+		assert(zz_get_int(zz_last_child(n2)) == i);
+		n1 = zz_first_child(n1);
+		n2 = zz_first_child(n2);
+	}
+	assert(zz_first_child(n2) == NULL);
+	zz_tree_destroy(&tree);
+}
+
+void destroy_chain(void)
+{
+	struct zz_tree tree;
+	struct zz_node *n;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	n = chain(&tree, DEPTH);
+	zz_destroy(n);
+	assert(zz_list_empty(&tree.nodes));
+	zz_tree_destroy(&tree);
+}
+
+void print_chain(void)
+{
+	struct zz_tree tree;
+	struct zz_node *n;
+	FILE *f;
+	char buf[32];
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	n = chain(&tree, DEPTH);
+	f = tmpfile();
+	zz_print(n, f);
+	rewind(f);
+	fgets(buf, 11, f);
+	assert(strcmp(buf, "[foo [foo ") == 0);
+	fseek(f, -18, SEEK_END);
+	fgets(buf, sizeof(buf), f);
+	assert(strcmp(buf, " [bar 2]] [bar 1]]") == 0);
+	fclose(f);
+	zz_tree_destroy(&tree);
+}
+
+int main(int argc, char *argv[])
+{
+	copy_chain();
+	destroy_chain();
+	print_chain();
+	exit(EXIT_SUCCESS);
+}
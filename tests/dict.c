@@ -1,5 +1,6 @@
 
 #include <assert.h>
+#include <stdio.h>
 #include <string.h>
 
 #include "../src/dict.h"
@@ -121,11 +122,48 @@ void insert_twice(void)
 	zz_dict_destroy(dict);
 }
 
+void insert_many(void)
+{
+	struct zz_dict *dict;
+	const char *vals[1000];
+	const char *s;
+	char buf[16];
+	int i;
+
+	dict = NULL;
+	for (i = 0; i < 1000; ++i) {
+		snprintf(buf, sizeof(buf), "%d", i);
+		dict = zz_dict_insert(dict, buf, &vals[i]);
+	}
+	for (i = 0; i < 1000; ++i) {
+		snprintf(buf, sizeof(buf), "%d", i);
+		assert(zz_dict_lookup(dict, buf, &s) == 1);
+		assert(s == vals[i]);
+		zz_dict_ref(vals[i]);
+	}
+	for (i = 0; i < 1000; i += 2)
+		dict = zz_dict_unref(dict, vals[i]);
+	for (i = 0; i < 1000; i += 2)
+		dict = zz_dict_unref(dict, vals[i]);
+	for (i = 0; i < 1000; ++i) {
+		snprintf(buf, sizeof(buf), "%d", i);
+		assert(zz_dict_lookup(dict, buf, &s) == i % 2);
+		if (i % 2)
+			assert(s == vals[i]);
+	}
+	for (i = 1; i < 1000; i += 2) {
+		dict = zz_dict_unref(dict, vals[i]);
+		dict = zz_dict_unref(dict, vals[i]);
+	}
+	assert(dict == NULL);
+}
+
 int main(int argc, char *argv[])
 {
 	empty_dict();
 	insert_vals();
 	delete_vals();
 	insert_twice();
+	insert_many();
 	exit(EXIT_SUCCESS);
 }
@@ -0,0 +1,186 @@
+/*
+ * Test for edits between trees
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+
+static const char *const NAMES[] = { "insert", "delete", "update", "move" };
+
+static const char *const TOKENS[] = { "a", "b", "c", "d", "e", "f" };
+
+/* Parse trees written in the format of zz_print(), with tokens of one
+ * letter and data that are integers */
+static struct zz_node *parse(struct zz_tree *tree, const char **s)
+{
+	struct zz_node *n;
+	const char *token;
+	char *end;
+
+	assert(**s == '[');
+	token = TOKENS[(*s)[1] - 'a'];
+	*s += 2;
+	if (**s == ' ' && (*s)[1] != '[')
+		n = zz_node(tree, token, zz_int(strtol(*s, &end, 10)));
+	else
+		n = zz_node(tree, token, zz_null);
+	if (n->data.type == ZZ_INT)
+		*s = end;
+	while (**s == ' ') {
+		++*s;
+		zz_append_child(n, parse(tree, s));
+	}
+	assert(**s == ']');
+	++*s;
+	return n;
+}
+
+static struct zz_node *tree_of(struct zz_tree *tree, const char *s)
+{
+	return parse(tree, &s);
+}
+
+static void print_edits(struct zz_diff *d)
+{
+	struct zz_edit *e;
+	size_t i;
+
+	for (i = 0; i < d->count; ++i) {
+		e = &d->edits[i];
+		printf("%s", NAMES[e->type]);
+		if (e->from != NULL) {
+			printf(" ");
+			zz_print(e->from, stdout);
+		}
+		if (e->to != NULL) {
+			printf(" to ");
+			zz_print(e->to, stdout);
+		}
+		if (e->parent != NULL)
+			printf(" at %s %zu", e->parent->token, e->index);
+		printf("\n");
+	}
+}
+
+static void diff(unsigned int flags, const char *from, const char *to)
+{
+	struct zz_tree a, b;
+	struct zz_diff d;
+	size_t size;
+
+	size = flags & ZZ_TREE_SHARED ?
+		sizeof(struct zz_shared_node) : sizeof(struct zz_node);
+	zz_tree_init_flags(&a, sizeof(struct zz_node), flags & ~ZZ_TREE_SHARED);
+	zz_tree_init_flags(&b, size, flags);
+	zz_diff_init(&d);
+	printf("%s -> %s\n", from, to);
+	zz_diff(&d, tree_of(&a, from), zz_copy_recursive(&b, tree_of(&a, to)));
+	print_edits(&d);
+	zz_diff_destroy(&d);
+	zz_tree_destroy(&b);
+	zz_tree_destroy(&a);
+}
+
+void cases(unsigned int flags)
+{
+	diff(flags, "[a [b 1] [c 2]]", "[a [b 1] [c 2]]");
+	diff(flags, "[a [b 1] [c 2]]", "[a [b 1] [c 3]]");
+	diff(flags, "[a 1 [b 1]]", "[a 2 [b 1]]");
+	diff(flags, "[a [b 1] [c 2] [d 3]]", "[a [b 1] [e 5] [c 2] [d 3]]");
+	diff(flags, "[a [b 1] [c 2] [d 3]]", "[a [b 1] [d 3]]");
+	diff(flags, "[a [b 1] [c 2] [d 3]]", "[a [d 3] [b 1] [c 2]]");
+	diff(flags, "[a [b 1] [c 2] [d 3]]", "[a [c 2] [b 1] [d 4]]");
+	diff(flags, "[a [b [c 1] [c 2]] [d]]", "[a [b [c 1]] [d [c 2]]]");
+	diff(flags, "[a [b 1 [c 1]] [b 2 [c 2]]]", "[a [b 2 [c 2]] [b 1 [c 3]]]");
+	diff(flags, "[a [b 1] [b 1] [b 1]]", "[a [b 1] [b 1]]");
+	diff(flags, "[a [b 1]]", "[e [b 1]]");
+}
+
+void wide(void)
+{
+	struct zz_tree tree;
+	struct zz_diff d;
+	struct zz_node *a, *b;
+	int i;
+
+	/* Many children, with a few changes far apart */
+	zz_tree_init_flags(&tree, sizeof(struct zz_node),
+			ZZ_TREE_PARENTS | ZZ_TREE_HASHES);
+	a = zz_node(&tree, TOKENS[0], zz_null);
+	b = zz_node(&tree, TOKENS[0], zz_null);
+	for (i = 0; i < 10000; ++i) {
+		zz_append_child(a, zz_node(&tree, TOKENS[1], zz_int(i)));
+		if (i != 10 && i != 5000)
+			zz_append_child(b, zz_node(&tree, TOKENS[1], zz_int(i)));
+		if (i == 9000)
+			zz_append_child(b, zz_node(&tree, TOKENS[2], zz_null));
+	}
+	zz_set_int(zz_child(b, 100), -1);
+	zz_diff_init(&d);
+	zz_diff(&d, a, b);
+	print_edits(&d);
+	assert(zz_diff(&d, a, a) == 0);
+	zz_diff_destroy(&d);
+	zz_tree_destroy(&tree);
+}
+
+void collision(void)
+{
+	struct zz_tree tree;
+	struct zz_diff d;
+	struct zz_node *a, *b;
+
+	/* Equal hashes don't make subtrees equal; changing data directly leaves
+	 * cached hashes stale, which makes them collide */
+	zz_tree_init_flags(&tree, sizeof(struct zz_node),
+			ZZ_TREE_PARENTS | ZZ_TREE_HASHES);
+	zz_diff_init(&d);
+	a = tree_of(&tree, "[a [b 1] [c 2] [b 3]]");
+	b = tree_of(&tree, "[a [b 1] [c 2] [b 3]]");
+	assert(zz_hash(a) == zz_hash(b));
+	zz_child(b, 2)->data = zz_int(4);
+	zz_child(b, 1)->token = TOKENS[3];
+	assert(zz_hash(a) == zz_hash(b));
+	assert(!zz_equal(a, b));
+	zz_diff(&d, a, b);
+	print_edits(&d);
+	assert(d.count == 3);
+	assert(d.edits[0].type == ZZ_EDIT_UPDATE);
+	assert(d.edits[0].from == zz_child(a, 2));
+	assert(d.edits[0].to == zz_child(b, 2));
+	assert(d.edits[1].type == ZZ_EDIT_DELETE);
+	assert(d.edits[1].from == zz_child(a, 1));
+	assert(d.edits[2].type == ZZ_EDIT_INSERT);
+	assert(d.edits[2].to == zz_child(b, 1));
+	assert(d.edits[2].index == 1);
+
+	/* A candidate that only has the same hash doesn't hide an equal one
+	 * after it */
+	a = tree_of(&tree, "[a [e 0] [b 4] [b 4]]");
+	b = tree_of(&tree, "[a [b 4] [e 0]]");
+	zz_hash(a);
+	zz_child(a, 1)->data = zz_int(9);
+	zz_diff(&d, a, b);
+	print_edits(&d);
+	assert(d.count == 2);
+	assert(d.edits[0].type == ZZ_EDIT_MOVE);
+	assert(d.edits[0].from == zz_child(a, 2));
+	assert(d.edits[0].to == zz_child(b, 0));
+	assert(d.edits[1].type == ZZ_EDIT_DELETE);
+	assert(d.edits[1].from == zz_child(a, 1));
+	zz_diff_destroy(&d);
+	zz_tree_destroy(&tree);
+}
+
+int main(int argc, char *argv[])
+{
+	cases(0);
+	/* Same edits for trees with known hashes */
+	cases(ZZ_TREE_PARENTS | ZZ_TREE_HASHES);
+	cases(ZZ_TREE_SHARED);
+	wide();
+	collision();
+	exit(EXIT_SUCCESS);
+}
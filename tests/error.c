@@ -21,6 +21,7 @@ int main(int argc, char *argv[])
 {
 	zz_error("prontf is not a function", "error.c", 9, 9, 9, 14);
 	zz_error("expected l-value", "error.c", 11, 9, 12, 49);
-	zz_error("error past end of file", "error.c", 27, 1, 27, 1);
+	zz_error("error past end of file", "error.c", 28, 1, 28, 1);
+	zz_error_cache_clear();
 	exit(EXIT_SUCCESS);
 }
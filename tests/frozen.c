@@ -0,0 +1,156 @@
+/*
+ * Test for frozen trees
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+
+struct node_with_location {
+	struct zz_node node;
+	int location;
+};
+
+struct compact_with_location {
+	struct zz_compact_node node;
+	int location;
+};
+
+static const char *TOK_FOO = "foo";
+static const char *TOK_BAR = "bar";
+static const char *TOK_BAZ = "baz";
+
+static void print(const struct zz_frozen *f, const struct zz_frozen_node *n)
+{
+	const struct zz_frozen_node *iter;
+
+	printf("[%s", n->token);
+	switch (n->data.type) {
+	case ZZ_INT:
+		printf(" %d", n->data.data.int_val);
+		break;
+	case ZZ_UINT:
+		printf(" %u", n->data.data.uint_val);
+		break;
+	case ZZ_DOUBLE:
+		printf(" %f", n->data.data.double_val);
+		break;
+	case ZZ_STRING:
+		printf(" \"%s\"", n->data.data.string_val);
+		break;
+	default:
+		break;
+	}
+	zz_frozen_foreach_child(iter, f, n) {
+		printf(" ");
+		print(f, iter);
+	}
+	printf("]");
+}
+
+/* Location is stored after the base node, whatever its layout */
+static int *location(struct zz_node *n)
+{
+	return (int *)((char *)n + zz_node_base_size(n->tree));
+}
+
+static struct zz_node *build(struct zz_tree *tree)
+{
+	struct zz_node *root, *n;
+	int loc;
+
+	root = zz_node(tree, TOK_FOO, zz_null);
+	zz_append_child(root, zz_node(tree, TOK_BAR, zz_int(-314)));
+	n = zz_node(tree, TOK_BAZ, zz_double(0.5));
+	zz_append_child(root, n);
+	zz_append_child(n, zz_node(tree, TOK_BAR, zz_string("314")));
+	zz_append_child(n, zz_node(tree, TOK_FOO, zz_uint(314)));
+	zz_append_child(root, zz_node(tree, TOK_BAZ, zz_tree_string(tree, "a")));
+	loc = 0;
+	zz_foreach_child(n, root)
+		*location(n) = ++loc;
+	return root;
+}
+
+void freeze(size_t node_size, unsigned int flags)
+{
+	struct zz_tree tree;
+	struct zz_frozen f;
+	const struct zz_frozen_node *iter, *n;
+	struct zz_node *root, *m;
+	int count;
+
+	zz_tree_init_flags(&tree, node_size, flags);
+	root = build(&tree);
+	zz_tree_freeze(root, &f);
+	assert(zz_frozen_count(&f) == 6);
+	assert(f.ext_size >= sizeof(int));
+	print(&f, zz_frozen_root(&f));
+	printf("\n");
+
+	/* Children and extension bytes */
+	n = zz_frozen_first_child(&f, zz_frozen_root(&f));
+	zz_foreach_child(m, root) {
+		assert(n->token == m->token);
+		assert(n->data.type == m->data.type);
+		assert(*(const int *)zz_frozen_ext(n) == *location(m));
+		n = zz_frozen_next_sibling(&f, n);
+	}
+	assert(n == NULL);
+	assert(zz_frozen_first_child(&f, zz_frozen_at(&f, 1)) == NULL);
+
+	/* Whole tree and subtrees are scanned in preorder */
+	count = 0;
+	zz_frozen_foreach(iter, &f, zz_frozen_root(&f)) {
+		assert(zz_frozen_index(&f, iter) == (size_t)count);
+		++count;
+	}
+	assert(count == 6);
+	n = zz_frozen_at(&f, 2);
+	assert(n->size == 3);
+	count = 0;
+	zz_frozen_foreach(iter, &f, n)
+		++count;
+	assert(count == 3);
+	assert(zz_frozen_end(&f, n) == zz_frozen_at(&f, 5));
+
+	/* Strings outlive the tree, even if they were pooled */
+	zz_destroy(root);
+	zz_tree_destroy(&tree);
+	assert(strcmp(zz_frozen_at(&f, 3)->data.data.string_val, "314") == 0);
+	assert(strcmp(zz_frozen_at(&f, 5)->data.data.string_val, "a") == 0);
+	zz_frozen_destroy(&f);
+}
+
+void single(void)
+{
+	struct zz_tree tree;
+	struct zz_frozen f;
+	const struct zz_frozen_node *iter;
+	int count;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	zz_tree_freeze(zz_node(&tree, TOK_FOO, zz_int(1)), &f);
+	assert(zz_frozen_count(&f) == 1);
+	assert(f.ext_size == 0);
+	assert(zz_frozen_first_child(&f, zz_frozen_root(&f)) == NULL);
+	assert(zz_frozen_next_sibling(&f, zz_frozen_root(&f)) == NULL);
+	count = 0;
+	zz_frozen_foreach(iter, &f, zz_frozen_root(&f))
+		++count;
+	assert(count == 1);
+	print(&f, zz_frozen_root(&f));
+	printf("\n");
+	zz_frozen_destroy(&f);
+	zz_tree_destroy(&tree);
+}
+
+int main(int argc, char *argv[])
+{
+	freeze(sizeof(struct node_with_location), 0);
+	freeze(sizeof(struct compact_with_location), ZZ_TREE_COMPACT);
+	freeze(sizeof(struct node_with_location), ZZ_TREE_STRING_POOL);
+	single();
+	exit(EXIT_SUCCESS);
+}
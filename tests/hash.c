@@ -0,0 +1,160 @@
+/*
+ * Test for structural hashing and equality of subtrees
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+
+static const char *TOK_CALL = "call";
+static const char *TOK_IDENT = "ident";
+static const char *TOK_ARGS = "args";
+static const char *TOK_NUM = "num";
+
+/* [call [ident "name"] [args [num 1] ... [num count]]] */
+static struct zz_node *call(struct zz_tree *tree, const char *name, int count)
+{
+	struct zz_node *n, *args;
+	int i;
+
+	n = zz_node(tree, TOK_CALL, zz_null);
+	zz_append_child(n, zz_node(tree, TOK_IDENT, zz_tree_string(tree, name)));
+	args = zz_node(tree, TOK_ARGS, zz_null);
+	zz_append_child(n, args);
+	for (i = 1; i <= count; ++i)
+		zz_append_child(args, zz_node(tree, TOK_NUM, zz_int(i)));
+	return n;
+}
+
+void compare(unsigned int flags)
+{
+	struct zz_tree tree, other;
+	struct zz_node *a, *b, *c, *n;
+	size_t hash;
+
+	zz_tree_init_flags(&tree, sizeof(struct zz_node), flags);
+	zz_tree_init_flags(&other, sizeof(struct zz_node), ZZ_TREE_STRING_POOL);
+	a = call(&tree, "printf", 3);
+	b = call(&other, "printf", 3);
+	c = call(&tree, "puts", 3);
+
+	/* Equal in different trees, even with strings from different pools */
+	assert(zz_equal(a, a));
+	assert(zz_equal(a, b));
+	assert(zz_equal(b, a));
+	assert(zz_hash(a) == zz_hash(b));
+	assert(zz_hash(a) == zz_hash(a));
+	assert(!zz_equal(a, c));
+	assert(zz_hash(a) != zz_hash(c));
+	assert(zz_equal(zz_last_child(a), zz_last_child(c)));
+	assert(zz_hash(zz_last_child(a)) == zz_hash(zz_last_child(c)));
+
+	/* Changes are seen by hashes computed before */
+	hash = zz_hash(a);
+	if (flags & ZZ_TREE_HASHES)
+		assert(*zz_cached_hash(a) == hash);
+	zz_set_int(zz_last_child(zz_last_child(a)), 4);
+	if (flags & ZZ_TREE_HASHES)
+		assert(*zz_cached_hash(a) == 0);
+	assert(zz_hash(a) != hash);
+	assert(!zz_equal(a, b));
+	zz_set_int(zz_last_child(zz_last_child(a)), 3);
+	assert(zz_hash(a) == hash);
+	assert(zz_equal(a, b));
+
+	n = zz_node(&tree, TOK_NUM, zz_int(4));
+	zz_append_child(zz_last_child(a), n);
+	assert(zz_hash(a) != hash);
+	assert(!zz_equal(a, b));
+	assert(!zz_equal(b, a));
+	if (flags & ZZ_TREE_PARENTS)
+		zz_unlink_child(n);
+	else
+		zz_remove_child(zz_last_child(a), n);
+	assert(zz_hash(a) == hash);
+	assert(zz_equal(a, b));
+	zz_prepend_child(zz_last_child(a), n);
+	assert(zz_hash(a) != hash);
+	zz_remove_child(zz_last_child(a), n);
+	assert(zz_hash(a) == hash);
+	zz_destroy(n);
+
+	/* The order of children matters */
+	n = zz_first_child(zz_last_child(a));
+	zz_remove_child(zz_last_child(a), n);
+	zz_append_child(zz_last_child(a), n);
+	assert(zz_hash(a) != hash);
+	assert(!zz_equal(a, b));
+
+	zz_tree_destroy(&other);
+	zz_tree_destroy(&tree);
+}
+
+void shared(void)
+{
+	struct zz_tree tree, shared;
+	struct zz_node *a, *b, *sa, *sb;
+
+	zz_tree_init_flags(&tree, sizeof(struct zz_node),
+			ZZ_TREE_PARENTS | ZZ_TREE_HASHES);
+	zz_tree_init_flags(&shared, sizeof(struct zz_shared_node), ZZ_TREE_SHARED);
+	a = call(&tree, "printf", 3);
+	b = call(&tree, "puts", 2);
+	sa = zz_copy_recursive(&shared, a);
+	sb = zz_copy_recursive(&shared, b);
+
+	/* Shared nodes hash like any other */
+	assert(zz_hash(sa) == zz_hash(a));
+	assert(zz_hash(sb) == zz_hash(b));
+	assert(zz_equal(sa, a));
+	assert(zz_equal(a, sa));
+	assert(!zz_equal(sa, sb));
+	assert(!zz_equal(sb, a));
+	assert(zz_equal(zz_first_child(sa), zz_first_child(a)));
+
+	zz_tree_destroy(&shared);
+	zz_tree_destroy(&tree);
+}
+
+void deep(void)
+{
+	struct zz_tree tree;
+	struct zz_node *a, *b, *n;
+	int i;
+
+	/* Deep trees don't need a deep call stack */
+	zz_tree_init_flags(&tree, sizeof(struct zz_node),
+			ZZ_TREE_PARENTS | ZZ_TREE_HASHES);
+	a = zz_node(&tree, TOK_NUM, zz_int(0));
+	b = zz_node(&tree, TOK_NUM, zz_int(0));
+	for (i = 0; i < 100000; ++i) {
+		n = zz_node(&tree, TOK_NUM, zz_int(i));
+		zz_prepend_child(n, a);
+		a = n;
+		n = zz_node(&tree, TOK_NUM, zz_int(i));
+		zz_prepend_child(n, b);
+		b = n;
+	}
+	assert(zz_hash(a) == zz_hash(b));
+	assert(zz_equal(a, b));
+	zz_tree_destroy(&tree);
+}
+
+int main(int argc, char *argv[])
+{
+	struct zz_tree tree;
+
+	compare(0);
+	compare(ZZ_TREE_COMPACT);
+	compare(ZZ_TREE_PARENTS | ZZ_TREE_HASHES);
+	compare(ZZ_TREE_COMPACT | ZZ_TREE_PARENTS | ZZ_TREE_HASHES);
+	shared();
+	deep();
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	zz_print(call(&tree, "printf", 2), stdout);
+	printf("\n");
+	zz_tree_destroy(&tree);
+	exit(EXIT_SUCCESS);
+}
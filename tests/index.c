@@ -0,0 +1,129 @@
+/*
+ * Test for trees that index their nodes by token
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+
+struct node_with_location {
+	struct zz_node node;
+	int location;
+};
+
+static struct zz_tokens tokens;
+static const char *TOK_CALL;
+static const char *TOK_IDENT;
+static const char *TOK_BODY;
+
+static size_t count_of(struct zz_tree *tree, const char *token)
+{
+	struct zz_node *n;
+	size_t count = 0;
+
+	zz_tree_foreach_of(n, tree, token) {
+		assert(n->token == token);
+		++count;
+	}
+	return count;
+}
+
+static void print_of(struct zz_tree *tree, const char *token)
+{
+	struct zz_node *n;
+
+	printf("%s:", token);
+	zz_tree_foreach_of(n, tree, token) {
+		printf(" ");
+		zz_print(n, stdout);
+	}
+	printf("\n");
+}
+
+void index_tokens(size_t node_size, unsigned int flags)
+{
+	struct zz_tree tree;
+	struct zz_node *root, *body, *call, *copy;
+	const char *late;
+	char name[16];
+	int i;
+
+	zz_tree_init_flags(&tree, node_size, flags | ZZ_TREE_TOKEN_INDEX);
+	zz_tree_set_tokens(&tree, &tokens);
+	assert(zz_tree_first_of(&tree, TOK_CALL) == NULL);
+	root = zz_node(&tree, TOK_BODY, zz_null);
+	for (i = 0; i < 3; ++i) {
+		call = zz_node(&tree, TOK_CALL, zz_null);
+		zz_append_child(root, call);
+		zz_append_child(call, zz_node(&tree, TOK_IDENT, zz_int(i)));
+	}
+	body = zz_node(&tree, TOK_BODY, zz_null);
+	zz_append_child(root, body);
+	zz_append_child(body, zz_node(&tree, TOK_IDENT, zz_int(3)));
+	print_of(&tree, TOK_CALL);
+	print_of(&tree, TOK_IDENT);
+	assert(count_of(&tree, TOK_BODY) == 2);
+
+	/* Tokens from elsewhere, even with the name of one in the registry,
+	 * have no nodes */
+	strcpy(name, "call");
+	assert(zz_tree_first_of(&tree, name) == NULL);
+	assert(zz_tree_first_of(&tree, "nothing") == NULL);
+
+	/* Tokens added after the index was created make it grow */
+	for (i = 0; i < 40; ++i) {
+		snprintf(name, sizeof(name), "late%zu", zz_tokens_count(&tokens));
+		zz_tokens_add(&tokens, name);
+	}
+	late = zz_tokens_lookup(&tokens, name);
+	assert(zz_token_id(late) >= 40);
+	zz_append_child(body, zz_node(&tree, late, zz_null));
+	assert(count_of(&tree, late) == 1);
+	assert(count_of(&tree, TOK_IDENT) == 4);
+
+	/* Destroyed nodes leave the index, copies and reused nodes join it */
+	call = zz_first_child(root);
+	zz_remove_child(root, call);
+	zz_destroy(call);
+	assert(count_of(&tree, TOK_CALL) == 2);
+	assert(count_of(&tree, TOK_IDENT) == 3);
+	copy = zz_copy_recursive(&tree, body);
+	assert(count_of(&tree, TOK_BODY) == 3);
+	assert(count_of(&tree, late) == 2);
+	zz_append_child(root, zz_node(&tree, TOK_CALL, zz_null));
+	print_of(&tree, TOK_CALL);
+	zz_destroy(copy);
+	print_of(&tree, TOK_IDENT);
+
+	/* Nodes can be destroyed while iterating, except the iterator */
+	zz_tree_foreach_of(call, &tree, TOK_CALL) {
+		if (zz_first_child(call) != NULL) {
+			body = zz_first_child(call);
+			zz_remove_child(call, body);
+			zz_destroy(body);
+		}
+	}
+	assert(count_of(&tree, TOK_IDENT) == 1);
+
+	zz_tree_reset(&tree);
+	assert(zz_tree_first_of(&tree, TOK_CALL) == NULL);
+	zz_node(&tree, TOK_CALL, zz_null);
+	assert(count_of(&tree, TOK_CALL) == 1);
+	zz_tree_destroy(&tree);
+}
+
+int main(int argc, char *argv[])
+{
+	zz_tokens_init(&tokens);
+	TOK_CALL = zz_tokens_add(&tokens, "call");
+	TOK_IDENT = zz_tokens_add(&tokens, "ident");
+	TOK_BODY = zz_tokens_add(&tokens, "body");
+	index_tokens(sizeof(struct node_with_location), 0);
+	index_tokens(sizeof(struct node_with_location), ZZ_TREE_PARENTS);
+	index_tokens(sizeof(struct zz_compact_node), ZZ_TREE_COMPACT);
+	index_tokens(sizeof(struct zz_compact_node),
+			ZZ_TREE_COMPACT | ZZ_TREE_PARENTS | ZZ_TREE_STRING_POOL);
+	zz_tokens_destroy(&tokens);
+	exit(EXIT_SUCCESS);
+}
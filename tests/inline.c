@@ -0,0 +1,123 @@
+/*
+ * Test for strings stored inline in data
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+
+static const char *TOK_FOO = "foo";
+static const char *TOK_BAR = "bar";
+
+static const char *const TOKENS[] = { "foo", "bar" };
+
+void data(void)
+{
+	struct zz_data a, b, c, d;
+
+	a = zz_string_inline("argc", 4);
+	assert(zz_string_is_inline(a));
+	assert(zz_string_length(a) == 4);
+	assert(strcmp(zz_data_string(&a), "argc") == 0);
+
+	/* Longest inline string, empty and with NUL */
+	b = zz_string_inline("1234567", 7);
+	assert(zz_string_is_inline(b));
+	assert(strcmp(zz_data_string(&b), "1234567") == 0);
+	b = zz_string_inline("", 0);
+	assert(zz_string_is_inline(b));
+	assert(zz_string_length(b) == 0);
+	assert(*zz_data_string(&b) == 0);
+	b = zz_string_inline("a\0b", 3);
+	assert(zz_string_length(b) == 3);
+	assert(memcmp(zz_data_string(&b), "a\0b", 4) == 0);
+
+	/* Longer strings are interned */
+	c = zz_string_inline("12345678", 8);
+	assert(!zz_string_is_inline(c));
+	d = zz_string("12345678");
+	assert(zz_data_string(&c) == zz_data_string(&d));
+	assert(zz_to_string(c) == zz_data_string(&c));
+	zz_data_destroy(d);
+	zz_data_destroy(c);
+
+	/* Copies are independent */
+	b = zz_data_copy(a);
+	assert(zz_data_string(&b) != zz_data_string(&a));
+	assert(strcmp(zz_data_string(&b), "argc") == 0);
+	zz_data_destroy(a);
+	zz_data_destroy(b);
+}
+
+static struct zz_node *build(struct zz_tree *tree)
+{
+	struct zz_node *root;
+
+	root = zz_node(tree, TOK_FOO, zz_tree_string(tree, "main"));
+	zz_append_child(root, zz_node(tree, TOK_BAR, zz_tree_string(tree, "x")));
+	zz_append_child(root, zz_node(tree, TOK_BAR,
+				zz_tree_string(tree, "a longer string")));
+	zz_append_child(root, zz_node(tree, TOK_BAR, zz_string_inline("y", 1)));
+	return root;
+}
+
+void tree(unsigned int flags)
+{
+	struct zz_tree tree, other;
+	struct zz_frozen f;
+	struct zz_node *root, *copy, *n;
+	FILE *file;
+
+	zz_tree_init_flags(&tree, sizeof(struct zz_node),
+			flags | ZZ_TREE_INLINE_STRINGS);
+	root = build(&tree);
+	assert(zz_string_is_inline(root->data));
+	assert(strcmp(zz_get_string(root), "main") == 0);
+	assert(zz_get_string_length(root) == 4);
+	assert(zz_string_is_inline(zz_last_child(root)->data));
+	n = zz_next_sibling(root, zz_first_child(root));
+	assert(!zz_string_is_inline(n->data));
+	zz_print(root, stdout);
+	printf("\n");
+
+	/* Copies, to the same tree and to another one */
+	copy = zz_copy_recursive(&tree, root);
+	assert(zz_get_string(copy) != zz_get_string(root));
+	zz_print(copy, stdout);
+	printf("\n");
+	zz_tree_init(&other, sizeof(struct zz_node));
+	zz_print(zz_copy_recursive(&other, root), stdout);
+	printf("\n");
+	zz_tree_destroy(&other);
+
+	/* Frozen copies, that keep them inline */
+	zz_tree_freeze(root, &f);
+	assert(zz_string_is_inline(zz_frozen_root(&f)->data));
+	assert(strcmp(zz_data_string(&zz_frozen_root(&f)->data), "main") == 0);
+	zz_frozen_destroy(&f);
+
+	/* Saved and loaded into a tree that interns them */
+	file = tmpfile();
+	assert(zz_tree_save(root, file) == 0);
+	rewind(file);
+	zz_tree_init_flags(&other, sizeof(struct zz_node), flags);
+	n = zz_tree_load(&other, file, TOKENS, 2);
+	assert(n != NULL);
+	assert(!zz_string_is_inline(n->data));
+	zz_print(n, stdout);
+	printf("\n");
+	fclose(file);
+	zz_tree_destroy(&other);
+
+	zz_tree_destroy(&tree);
+}
+
+int main(int argc, char *argv[])
+{
+	data();
+	tree(0);
+	tree(ZZ_TREE_STRING_POOL);
+	tree(ZZ_TREE_COMPACT);
+	exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,165 @@
+/*
+ * Test for parent links, child count and indexed children
+ */
+
+#include <assert.h>
+
+#include "../src/zebu.h"
+
+struct node_with_location {
+	struct zz_node node;
+	int location;
+};
+
+struct compact_with_location {
+	struct zz_compact_node node;
+	int location;
+};
+
+static const char *TOK_FOO = "foo";
+static const char *TOK_BAR = "bar";
+
+#define CHILDREN 10
+
+/* Check that zz_child() agrees with iteration for every index, in order and
+ * out of it */
+static void check_children(struct zz_node *n)
+{
+	static const size_t order[] = { 3, 9, 0, 5, 4, 8, 1, 2, 7, 6 };
+	struct zz_node *children[CHILDREN + 1], *c;
+	size_t count, i;
+
+	count = 0;
+	zz_foreach_child(c, n)
+		children[count++] = c;
+	assert(zz_child_count(n) == count);
+	for (i = 0; i < count; ++i)
+		assert(zz_child(n, i) == children[i]);
+	for (i = 0; i < sizeof(order) / sizeof(*order); ++i) {
+		if (order[i] < count)
+			assert(zz_child(n, order[i]) == children[order[i]]);
+	}
+	assert(zz_child(n, count) == NULL);
+}
+
+void links(size_t node_size, unsigned int flags)
+{
+	struct zz_tree tree;
+	struct zz_node *root, *n, *copy, *c;
+	int i;
+
+	zz_tree_init_flags(&tree, node_size, flags | ZZ_TREE_PARENTS);
+	root = zz_node(&tree, TOK_FOO, zz_null);
+	assert(zz_parent(root) == NULL);
+	assert(zz_child_count(root) == 0);
+	assert(zz_child(root, 0) == NULL);
+	for (i = 0; i < CHILDREN / 2; ++i)
+		zz_append_child(root, zz_node(&tree, TOK_BAR, zz_int(i)));
+	check_children(root);
+	/* Prepending moves the cursor of zz_child() */
+	assert(zz_get_int(zz_child(root, 2)) == 2);
+	for (i = 0; i < CHILDREN / 2; ++i)
+		zz_prepend_child(root, zz_node(&tree, TOK_BAR, zz_int(-i - 1)));
+	assert(zz_get_int(zz_child(root, 7)) == 2);
+	check_children(root);
+	zz_foreach_child(n, root)
+		assert(zz_parent(n) == root);
+
+	/* Grandchildren */
+	n = zz_child(root, 4);
+	zz_append_child(n, zz_node(&tree, TOK_FOO, zz_null));
+	assert(zz_parent(zz_first_child(n)) == n);
+	assert(zz_child_count(root) == CHILDREN);
+	assert(zz_child_count(n) == 1);
+
+	/* Remove first, last and middle children, and unlink a subtree */
+	c = zz_child(root, 0);
+	zz_unlink_child(c);
+	assert(zz_parent(c) == NULL);
+	zz_destroy(c);
+	c = zz_child(root, CHILDREN - 2);
+	zz_remove_child(root, c);
+	zz_destroy(c);
+	c = zz_child(root, 4);
+	zz_unlink_child(c);
+	zz_destroy(c);
+	assert(zz_child_count(root) == CHILDREN - 3);
+	check_children(root);
+	zz_unlink_child(n);
+	zz_unlink_child(n);
+	assert(zz_parent(n) == NULL);
+	assert(zz_child_count(root) == CHILDREN - 4);
+	zz_append_child(root, n);
+	assert(zz_parent(n) == root);
+	assert(zz_child(root, CHILDREN - 4) == n);
+
+	/* Copies get their own links */
+	copy = zz_copy_recursive(&tree, root);
+	assert(zz_parent(copy) == NULL);
+	assert(zz_child_count(copy) == zz_child_count(root));
+	zz_foreach_child(c, copy)
+		assert(zz_parent(c) == copy);
+	check_children(copy);
+	zz_print(copy, stdout);
+	printf("\n");
+	zz_destroy(copy);
+	zz_tree_destroy(&tree);
+}
+
+void no_links(void)
+{
+	struct zz_tree tree;
+	struct zz_node *root;
+	int i;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	root = zz_node(&tree, TOK_FOO, zz_null);
+	for (i = 0; i < CHILDREN; ++i)
+		zz_append_child(root, zz_node(&tree, TOK_BAR, zz_int(i)));
+	assert(!zz_has_parents(root));
+	check_children(root);
+	zz_tree_destroy(&tree);
+}
+
+void frozen(void)
+{
+	struct zz_tree tree;
+	struct zz_frozen f;
+	const struct zz_frozen_node *r, *c;
+	struct zz_node *root, *n;
+	size_t i;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	root = zz_node(&tree, TOK_FOO, zz_null);
+	for (i = 0; i < CHILDREN; ++i) {
+		n = zz_node(&tree, TOK_BAR, zz_int(i));
+		zz_append_child(root, n);
+		zz_append_child(n, zz_node(&tree, TOK_FOO, zz_int(-(int)i)));
+	}
+	zz_tree_freeze(root, &f);
+	r = zz_frozen_root(&f);
+	assert(zz_frozen_parent(&f, r) == NULL);
+	assert(zz_frozen_child_count(&f, r) == CHILDREN);
+	i = 0;
+	zz_frozen_foreach_child(c, &f, r) {
+		assert(zz_frozen_child(&f, r, i) == c);
+		assert(zz_frozen_parent(&f, c) == r);
+		assert(zz_frozen_child_count(&f, c) == 1);
+		assert(zz_frozen_parent(&f, zz_frozen_child(&f, c, 0)) == c);
+		assert(zz_frozen_child(&f, c, 1) == NULL);
+		++i;
+	}
+	assert(zz_frozen_child(&f, r, CHILDREN) == NULL);
+	assert(zz_frozen_child(&f, r, 7)->data.data.int_val == 7);
+	zz_frozen_destroy(&f);
+	zz_tree_destroy(&tree);
+}
+
+int main(int argc, char *argv[])
+{
+	links(sizeof(struct node_with_location), 0);
+	links(sizeof(struct compact_with_location), ZZ_TREE_COMPACT);
+	no_links();
+	frozen();
+	exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,70 @@
+/*
+ * Test for trees with their own string pool
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+
+static const char *TOK_FOO = "foo";
+static const char *TOK_BAR = "bar";
+
+/* Pooled strings are interned per tree */
+void intern_strings(void)
+{
+	struct zz_tree t1, t2;
+	struct zz_node *n1, *n2, *n3, *n4;
+
+	zz_tree_init_flags(&t1, sizeof(struct zz_node), ZZ_TREE_STRING_POOL);
+	zz_tree_init_flags(&t2, sizeof(struct zz_node), ZZ_TREE_STRING_POOL);
+	n1 = zz_node(&t1, TOK_FOO, zz_tree_string(&t1, "foo"));
+	n2 = zz_node(&t1, TOK_BAR, zz_tree_string(&t1, "foo"));
+	n3 = zz_node(&t2, TOK_FOO, zz_tree_string(&t2, "foo"));
+	n4 = zz_node(&t2, TOK_BAR, zz_string("foo"));
+	assert(zz_get_string(n1) == zz_get_string(n2));
+	assert(zz_get_string(n1) != zz_get_string(n3));
+	assert(zz_get_string(n3) != zz_get_string(n4));
+	assert(strcmp(zz_get_string(n1), "foo") == 0);
+	assert(strcmp(zz_get_string(n3), "foo") == 0);
+	zz_set_string(n2, "bar");
+	assert(strcmp(zz_get_string(n2), "bar") == 0);
+	zz_set_string_n(n2, "foobar", 3);
+	assert(zz_get_string(n2) == zz_get_string(n1));
+	assert(zz_get_string_length(n2) == 3);
+	zz_destroy(n1);
+	assert(strcmp(zz_get_string(n3), "foo") == 0);
+	zz_tree_destroy(&t1);
+	assert(strcmp(zz_get_string(n3), "foo") == 0);
+	assert(strcmp(zz_get_string(n4), "foo") == 0);
+	zz_tree_destroy(&t2);
+}
+
+/* Copies to another tree must not reference the pool of the original */
+void copy_strings(void)
+{
+	struct zz_tree t1, t2, t3;
+	struct zz_node *n1, *n2, *n3;
+
+	zz_tree_init_flags(&t1, sizeof(struct zz_node), ZZ_TREE_STRING_POOL);
+	zz_tree_init_flags(&t2, sizeof(struct zz_node), ZZ_TREE_STRING_POOL);
+	zz_tree_init(&t3, sizeof(struct zz_node));
+	n1 = zz_node(&t1, TOK_FOO, zz_tree_string(&t1, "foo"));
+	zz_append_child(n1, zz_node(&t1, TOK_BAR, zz_tree_string(&t1, "bar")));
+	n2 = zz_copy_recursive(&t2, n1);
+	n3 = zz_copy_recursive(&t3, n1);
+	zz_tree_destroy(&t1);
+	assert(strcmp(zz_get_string(n2), "foo") == 0);
+	assert(strcmp(zz_get_string(zz_first_child(n2)), "bar") == 0);
+	assert(strcmp(zz_get_string(n3), "foo") == 0);
+	assert(strcmp(zz_get_string(zz_first_child(n3)), "bar") == 0);
+	zz_tree_destroy(&t2);
+	zz_tree_destroy(&t3);
+}
+
+int main(int argc, char *argv[])
+{
+	intern_strings();
+	copy_strings();
+	exit(EXIT_SUCCESS);
+}
@@ -1,5 +1,7 @@
 
 #include <assert.h>
+#include <math.h>
+#include <string.h>
 
 #include "../src/zebu.h"
 
@@ -7,11 +9,41 @@ static const char *TOK_FOO = "foo";
 static const char *TOK_BAR = "bar";
 static const char *TOK_BAZ = "baz";
 
+static const char *EXPECTED =
+	"[foo [bar] [baz -314] [bar 314] [baz 0.500000] [bar \"314\"] [baz (nil)]]";
+
+static const double DOUBLES[] = {
+	0, -0.0, 1, -1, 0.1, 1.0 / 3, 2.5e-7, 5e-7, 1e300, -123456.654321,
+	4503599627.370496, HUGE_VAL, -HUGE_VAL, NAN
+};
+
+void print_doubles(void)
+{
+	struct zz_tree tree;
+	struct zz_node *node;
+	char buf[512], expected[512], *str;
+	size_t i, size;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	for (i = 0; i < sizeof(DOUBLES) / sizeof(*DOUBLES); ++i) {
+		node = zz_node(&tree, TOK_FOO, zz_double(DOUBLES[i]));
+		snprintf(expected, sizeof(expected), "[foo %f]", DOUBLES[i]);
+		size = sizeof(buf);
+		str = zz_print_to_buffer(node, buf, &size);
+		assert(str == buf);
+		assert(size == strlen(expected));
+		assert(strcmp(str, expected) == 0);
+	}
+	zz_tree_destroy(&tree);
+}
+
 int main(int argc, char *argv[])
 {
 	struct zz_tree tree;
 	struct zz_node *root;
 	struct zz_node *node;
+	char buf[16], *str;
+	size_t size;
 
 	zz_tree_init(&tree, sizeof(struct zz_node));
 
@@ -33,5 +65,21 @@ int main(int argc, char *argv[])
 
 	zz_print(root, stdout);
 	printf("\n");
+
+	size = sizeof(buf);
+	str = zz_print_to_buffer(root, buf, &size);
+	assert(str != NULL && str != buf);
+	assert(size == strlen(EXPECTED));
+	assert(strcmp(str, EXPECTED) == 0);
+	free(str);
+
+	size = 0;
+	str = zz_print_to_buffer(root, NULL, &size);
+	assert(str != NULL);
+	assert(strcmp(str, EXPECTED) == 0);
+	free(str);
+
+	print_doubles();
+	zz_tree_destroy(&tree);
 	exit(EXIT_SUCCESS);
 }
@@ -0,0 +1,147 @@
+/*
+ * Test for reference counted nodes of shared trees
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+
+static const char *TOK_FILE = "file";
+static const char *TOK_EXPAND = "expand";
+static const char *TOK_CALL = "call";
+static const char *TOK_IDENT = "ident";
+static const char *TOK_NUM = "num";
+
+/* [call [ident "name"] [num 1] ... [num count]] */
+static struct zz_node *call(struct zz_tree *tree, const char *name, int count)
+{
+	struct zz_node *n;
+	int i;
+
+	n = zz_node(tree, TOK_CALL, zz_null);
+	zz_append_child(n, zz_node(tree, TOK_IDENT, zz_string(name)));
+	for (i = 1; i <= count; ++i)
+		zz_append_child(n, zz_node(tree, TOK_NUM, zz_int(i)));
+	return n;
+}
+
+static void print(const char *name, struct zz_node *n)
+{
+	printf("%s ", name);
+	zz_print(n, stdout);
+	printf(" (%zu refs, %zu nodes)\n", ZZ_SHARED(n)->refs,
+			n->tree->node_count);
+}
+
+void expand(void)
+{
+	struct zz_tree tree, shared;
+	struct zz_node *body, *expansions[3], *file;
+	int i;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	zz_tree_init_flags(&shared, sizeof(struct zz_shared_node), ZZ_TREE_SHARED);
+	body = zz_copy_recursive(&shared, call(&tree, "f", 3));
+	print("body", body);
+
+	/* The body is attached to each expansion, not copied */
+	for (i = 0; i < 3; ++i) {
+		expansions[i] = zz_node_shared(&shared, TOK_EXPAND, zz_int(i),
+				&body, 1);
+		assert(zz_first_child(expansions[i]) == body);
+	}
+	file = zz_node_shared(&shared, TOK_FILE, zz_null, expansions, 3);
+	print("body", body);
+	print("file", file);
+
+	/* References are dropped in any order */
+	zz_unref(body);
+	print("body", body);
+	for (i = 0; i < 3; ++i)
+		zz_unref(expansions[i]);
+	print("file", file);
+	zz_unref(file);
+	assert(shared.node_count == 0);
+
+	zz_tree_destroy(&shared);
+	zz_tree_destroy(&tree);
+}
+
+void owned(void)
+{
+	struct zz_tree tree;
+	struct zz_node *n, *p, *c[2];
+
+	zz_tree_init_flags(&tree, sizeof(struct zz_shared_node), ZZ_TREE_SHARED);
+
+	/* Callers own the nodes they get, and parents their children */
+	n = zz_node(&tree, TOK_NUM, zz_int(1));
+	assert(ZZ_SHARED(n)->refs == 1);
+	zz_unref(n);
+	assert(tree.node_count == 0);
+	c[0] = zz_node(&tree, TOK_NUM, zz_int(1));
+	c[1] = zz_node(&tree, TOK_NUM, zz_int(2));
+	p = zz_node_shared(&tree, TOK_CALL, zz_null, c, 2);
+	zz_unref(c[0]);
+	zz_unref(c[1]);
+	assert(tree.node_count == 3);
+	assert(ZZ_SHARED(c[0])->refs == 1);
+	zz_unref(p);
+	assert(tree.node_count == 0);
+
+	/* Getting an existing node takes a reference too, so dropping it
+	 * leaves the parents of the node alone */
+	c[0] = zz_node(&tree, TOK_NUM, zz_int(1));
+	p = zz_node_shared(&tree, TOK_CALL, zz_null, c, 1);
+	n = zz_node(&tree, TOK_NUM, zz_int(1));
+	assert(n == c[0]);
+	assert(ZZ_SHARED(n)->refs == 3);
+	zz_unref(n);
+	n = zz_node(&tree, TOK_NUM, zz_int(2));
+	assert(n != c[0]);
+	assert(zz_first_child(p) == c[0]);
+	assert(zz_get_int(c[0]) == 1);
+	zz_print(p, stdout);
+	printf("\n");
+	zz_unref(n);
+	zz_unref(c[0]);
+	zz_unref(p);
+	assert(tree.node_count == 0);
+
+	/* A node may be a child of the same parent more than once */
+	c[0] = c[1] = zz_node(&tree, TOK_NUM, zz_int(3));
+	p = zz_node_shared(&tree, TOK_CALL, zz_null, c, 2);
+	assert(ZZ_SHARED(c[0])->refs == 3);
+	zz_unref(c[0]);
+	zz_unref(p);
+	assert(tree.node_count == 0);
+	zz_tree_destroy(&tree);
+}
+
+void single(void)
+{
+	struct zz_tree tree;
+	struct zz_node *n, *c;
+
+	/* Other nodes have a single owner, their parent until they are
+	 * removed */
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	n = call(&tree, "g", 2);
+	assert(tree.node_count == 4);
+	c = zz_last_child(n);
+	zz_remove_child(n, c);
+	zz_unref(c);
+	assert(tree.node_count == 3);
+	zz_unref(n);
+	assert(tree.node_count == 0);
+	zz_tree_destroy(&tree);
+}
+
+int main(int argc, char *argv[])
+{
+	expand();
+	owned();
+	single();
+	exit(EXIT_SUCCESS);
+}
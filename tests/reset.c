@@ -0,0 +1,78 @@
+/*
+ * Test for reusing trees after a reset
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+
+static const char *TOK_FOO = "foo";
+static const char *TOK_BAR = "bar";
+
+static struct zz_node *build(struct zz_tree *tree, size_t count)
+{
+	struct zz_node *root;
+	char buf[32];
+	size_t i;
+
+	root = zz_node(tree, TOK_FOO, zz_string("global"));
+	for (i = 0; i < count; ++i) {
+		snprintf(buf, sizeof(buf), "%zu", i);
+		zz_append_child(root, zz_node(tree, TOK_BAR,
+					zz_tree_string(tree, buf)));
+	}
+	return root;
+}
+
+int main(int argc, char *argv[])
+{
+	struct zz_tree tree;
+	struct zz_tree_stats stats;
+	struct zz_dict_stats strings;
+	struct zz_node *root;
+	size_t allocated, global;
+
+	zz_strings_stats(&strings);
+	global = strings.count;
+
+	zz_tree_init_flags(&tree, sizeof(struct zz_node), ZZ_TREE_STRING_POOL);
+	root = build(&tree, 1000);
+	zz_destroy(zz_first_child(root));
+	zz_tree_stats(&tree, &stats);
+	allocated = stats.allocated;
+	assert(stats.nodes == 1000);
+
+	zz_tree_reset(&tree);
+	zz_tree_stats(&tree, &stats);
+	assert(stats.nodes == 0);
+	assert(stats.peak_nodes == 0);
+	assert(stats.peak_node_bytes == 0);
+	assert(stats.strings.count == 0);
+	assert(stats.strings.hits == 0);
+	assert(stats.strings.misses == 0);
+	assert(stats.allocated == allocated);
+	zz_strings_stats(&strings);
+	assert(strings.count == global);
+
+	/* The same tree again fits in the same memory */
+	root = build(&tree, 1000);
+	zz_tree_stats(&tree, &stats);
+	assert(stats.nodes == 1001);
+	assert(stats.peak_nodes == 1001);
+	assert(stats.strings.count == 1000);
+	assert(stats.strings.misses == 1000);
+	assert(stats.allocated == allocated);
+	assert(strcmp(zz_get_string(zz_last_child(root)), "999") == 0);
+	assert(strcmp(zz_get_string(root), "global") == 0);
+
+	/* A larger one needs more */
+	zz_tree_reset(&tree);
+	root = build(&tree, 2000);
+	zz_tree_stats(&tree, &stats);
+	assert(stats.nodes == 2001);
+	assert(stats.allocated > allocated);
+	assert(strcmp(zz_get_string(zz_last_child(root)), "1999") == 0);
+	zz_tree_destroy(&tree);
+	exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,145 @@
+/*
+ * Test for saving and loading trees
+ */
+
+#include <assert.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../src/zebu.h"
+
+struct node_with_location {
+	struct zz_node node;
+	int location;
+};
+
+static const char *TOK_FOO = "foo";
+static const char *TOK_BAR = "bar";
+static const char *TOK_BAZ = "baz";
+
+static const char *const TOKENS[] = { "foo", "bar", "baz" };
+
+static struct zz_node *build(struct zz_tree *tree)
+{
+	struct zz_node *root, *n;
+	int i;
+
+	root = zz_node(tree, TOK_FOO, zz_null);
+	zz_append_child(root, zz_node(tree, TOK_BAR, zz_int(-314)));
+	zz_append_child(root, zz_node(tree, TOK_BAZ, zz_uint(314)));
+	n = zz_node(tree, TOK_FOO, zz_double(0.5));
+	zz_append_child(root, n);
+	zz_append_child(n, zz_node(tree, TOK_BAR, zz_string("314")));
+	zz_append_child(n, zz_node(tree, TOK_BAZ, zz_pointer(tree)));
+	zz_append_child(n, zz_node(tree, TOK_BAR, zz_string("314")));
+	zz_append_child(root, zz_node(tree, TOK_BAZ, zz_string_n("a\0b", 3)));
+	i = 0;
+	zz_foreach_child(n, root)
+		((struct node_with_location *)n)->location = ++i;
+	return root;
+}
+
+void save_and_load(void)
+{
+	struct zz_tree t1, t2;
+	struct zz_node *n1, *n2, *i1, *i2;
+	FILE *f;
+
+	zz_tree_init(&t1, sizeof(struct node_with_location));
+	zz_tree_init_flags(&t2, sizeof(struct node_with_location),
+			ZZ_TREE_STRING_POOL);
+	n1 = build(&t1);
+	f = tmpfile();
+	assert(zz_tree_save(n1, f) == 0);
+	rewind(f);
+	n2 = zz_tree_load(&t2, f, TOKENS, 3);
+	fclose(f);
+	assert(n2 != NULL);
+	zz_print(n2, stdout);
+	printf("\n");
+
+	assert(n2->token == TOK_FOO);
+	i2 = zz_first_child(n2);
+	zz_foreach_child(i1, n1) {
+		assert(i1->token == i2->token);
+		assert(((struct node_with_location *)i1)->location ==
+				((struct node_with_location *)i2)->location);
+		i2 = zz_next_sibling(n2, i2);
+	}
+	assert(i2 == NULL);
+	i2 = zz_last_child(n2);
+	assert(zz_get_string_length(i2) == 3);
+	assert(memcmp(zz_get_string(i2), "a\0b", 4) == 0);
+	n2 = zz_prev_sibling(n2, i2);
+	i2 = zz_first_child(n2);
+	assert(zz_get_string(i2) == zz_get_string(zz_last_child(n2)));
+	assert(zz_get_pointer(zz_next_sibling(n2, i2)) == NULL);
+
+	zz_tree_destroy(&t1);
+	zz_tree_destroy(&t2);
+}
+
+void load_errors(void)
+{
+	struct zz_tree t1, t2;
+	struct zz_node *n;
+	FILE *f;
+
+	zz_tree_init(&t1, sizeof(struct node_with_location));
+	n = build(&t1);
+
+	/* Missing token */
+	zz_tree_init(&t2, sizeof(struct node_with_location));
+	f = tmpfile();
+	zz_tree_save(n, f);
+	rewind(f);
+	assert(zz_tree_load(&t2, f, TOKENS, 2) == NULL);
+	fclose(f);
+	assert(zz_list_empty(&t2.nodes));
+	zz_tree_destroy(&t2);
+
+	/* Different node size */
+	zz_tree_init(&t2, sizeof(struct zz_node));
+	f = tmpfile();
+	zz_tree_save(n, f);
+	rewind(f);
+	assert(zz_tree_load(&t2, f, TOKENS, 3) == NULL);
+	fclose(f);
+	zz_tree_destroy(&t2);
+
+	/* Truncated file */
+	zz_tree_init(&t2, sizeof(struct node_with_location));
+	f = tmpfile();
+	zz_tree_save(n, f);
+	rewind(f);
+	fputs("ZEBU", f);
+	fflush(f);
+	ftruncate(fileno(f), ftell(f) + 64);
+	rewind(f);
+	assert(zz_tree_load(&t2, f, TOKENS, 3) == NULL);
+	fclose(f);
+	zz_tree_destroy(&t2);
+
+	/* Shared trees can't be loaded into */
+	zz_tree_init(&t2, sizeof(struct zz_node));
+	n = zz_node(&t2, TOK_FOO, zz_int(1));
+	zz_append_child(n, zz_node(&t2, TOK_BAR, zz_int(2)));
+	f = tmpfile();
+	assert(zz_tree_save(n, f) == 0);
+	zz_tree_destroy(&t2);
+	zz_tree_init_flags(&t2, sizeof(struct zz_shared_node), ZZ_TREE_SHARED);
+	rewind(f);
+	assert(zz_tree_load(&t2, f, TOKENS, 3) == NULL);
+	fclose(f);
+	assert(t2.shared_count == 0);
+	zz_tree_destroy(&t2);
+
+	zz_tree_destroy(&t1);
+}
+
+int main(int argc, char *argv[])
+{
+	save_and_load();
+	load_errors();
+	exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,151 @@
+/*
+ * Test for trees that hash-cons their nodes
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+
+static const char *TOK_FUNC = "func";
+static const char *TOK_TYPE = "type";
+static const char *TOK_IDENT = "ident";
+static const char *TOK_ARG = "arg";
+static const char *TOK_POINTER = "pointer";
+static const char *TOK_ARGLIST = "arglist";
+
+/* Same function as tests/build.c, in a tree that doesn't share nodes */
+static struct zz_node *build(struct zz_tree *tree)
+{
+	struct zz_node *func, *args, *arg, *p;
+
+	func = zz_node(tree, TOK_FUNC, zz_null);
+	zz_append_child(func, zz_node(tree, TOK_TYPE, zz_string("int")));
+	zz_append_child(func, zz_node(tree, TOK_IDENT, zz_string("main")));
+	args = zz_node(tree, TOK_ARGLIST, zz_null);
+	zz_append_child(func, args);
+	arg = zz_node(tree, TOK_ARG, zz_null);
+	zz_append_child(args, arg);
+	zz_append_child(arg, zz_node(tree, TOK_TYPE, zz_string("int")));
+	zz_append_child(arg, zz_node(tree, TOK_IDENT, zz_string("argc")));
+	arg = zz_node(tree, TOK_ARG, zz_null);
+	zz_append_child(args, arg);
+	p = zz_node(tree, TOK_POINTER, zz_null);
+	zz_append_child(arg, p);
+	zz_append_child(p, zz_node(tree, TOK_POINTER, zz_null));
+	zz_append_child(zz_first_child(p),
+			zz_node(tree, TOK_TYPE, zz_string("int")));
+	zz_append_child(arg, zz_node(tree, TOK_IDENT, zz_string("argv")));
+	return func;
+}
+
+void share(void)
+{
+	struct zz_tree tree;
+	struct zz_node *a, *b, *c, *pair[2], *n;
+	size_t i;
+
+	zz_tree_init_flags(&tree, sizeof(struct zz_shared_node),
+			ZZ_TREE_SHARED | ZZ_TREE_STRING_POOL);
+
+	/* Equal leaves are the same node */
+	a = zz_node(&tree, TOK_TYPE, zz_tree_string(&tree, "int"));
+	b = zz_node_shared(&tree, TOK_TYPE, zz_tree_string(&tree, "int"), NULL, 0);
+	assert(a == b);
+	assert(zz_node(&tree, TOK_TYPE, zz_tree_string(&tree, "char")) != a);
+	assert(zz_node(&tree, TOK_IDENT, zz_tree_string(&tree, "int")) != a);
+	assert(zz_node(&tree, TOK_TYPE, zz_int(1)) ==
+			zz_node(&tree, TOK_TYPE, zz_int(1)));
+	assert(zz_node(&tree, TOK_TYPE, zz_int(1)) !=
+			zz_node(&tree, TOK_TYPE, zz_uint(1)));
+	assert(tree.node_count == 5);
+
+	/* And so are nodes with the same children, in the same order */
+	pair[0] = a;
+	pair[1] = zz_node(&tree, TOK_IDENT, zz_tree_string(&tree, "argc"));
+	c = zz_node_shared(&tree, TOK_ARG, zz_null, pair, 2);
+	assert(zz_node_shared(&tree, TOK_ARG, zz_null, pair, 2) == c);
+	assert(zz_node_shared(&tree, TOK_ARG, zz_null, pair, 1) != c);
+	n = pair[0];
+	pair[0] = pair[1];
+	pair[1] = n;
+	assert(zz_node_shared(&tree, TOK_ARG, zz_null, pair, 2) != c);
+	assert(zz_child_count(c) == 2);
+	assert(zz_child(c, 0) == a);
+	assert(zz_child(c, 2) == NULL);
+	assert(zz_first_child(c) == a);
+	assert(zz_next_sibling(c, a) == zz_last_child(c));
+	assert(zz_prev_sibling(c, a) == NULL);
+
+	/* A node may be a child more than once; iteration follows positions */
+	pair[0] = pair[1] = c;
+	n = zz_node_shared(&tree, TOK_ARGLIST, zz_null, pair, 2);
+	i = 0;
+	zz_foreach_child(b, n) {
+		assert(b == c);
+		++i;
+	}
+	assert(i == 2);
+	zz_reverse_foreach_child(b, n)
+		--i;
+	assert(i == 0);
+	zz_print(n, stdout);
+	printf("\n");
+
+	/* Nodes are not destroyed one by one */
+	zz_destroy(n);
+	assert(zz_child(n, 1) == c);
+
+	zz_tree_reset(&tree);
+	assert(tree.node_count == 0);
+	assert(zz_node(&tree, TOK_TYPE, zz_string("int")) ==
+			zz_node(&tree, TOK_TYPE, zz_string("int")));
+	zz_tree_destroy(&tree);
+}
+
+void copy(void)
+{
+	struct zz_tree tree, shared, other;
+	struct zz_node *root, *copy, *args, *again;
+	struct zz_tree_stats stats;
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	root = build(&tree);
+	zz_tree_stats(&tree, &stats);
+	printf("nodes %zu\n", stats.nodes);
+
+	zz_tree_init_flags(&shared, sizeof(struct zz_shared_node), ZZ_TREE_SHARED);
+	copy = zz_copy_recursive(&shared, root);
+	zz_print(copy, stdout);
+	printf("\n");
+	zz_tree_stats(&shared, &stats);
+	printf("shared nodes %zu\n", stats.nodes);
+
+	/* The three occurrences of [type "int"] are one node */
+	args = zz_child(copy, 2);
+	assert(zz_first_child(copy) == zz_first_child(zz_first_child(args)));
+	assert(zz_first_child(copy) == zz_first_child(zz_first_child(
+					zz_first_child(zz_last_child(args)))));
+
+	/* Equal subtrees are the same node */
+	again = zz_copy_recursive(&shared, root);
+	assert(again == copy);
+	assert(zz_copy_recursive(&shared, zz_child(root, 2)) == args);
+	assert(zz_copy_recursive(&shared, copy) == copy);
+
+	/* Copies back to a tree that doesn't share nodes */
+	zz_tree_init(&other, sizeof(struct zz_node));
+	zz_print(zz_copy_recursive(&other, copy), stdout);
+	printf("\n");
+	zz_tree_destroy(&other);
+
+	zz_tree_destroy(&shared);
+	zz_tree_destroy(&tree);
+}
+
+int main(int argc, char *argv[])
+{
+	share();
+	copy();
+	exit(EXIT_SUCCESS);
+}
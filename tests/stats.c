@@ -0,0 +1,119 @@
+/*
+ * Test for memory usage statistics
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+
+static const char *TOK_FOO = "foo";
+static const char *TOK_BAR = "bar";
+
+void tree_stats(void)
+{
+	struct zz_tree tree;
+	struct zz_tree_stats stats;
+	struct zz_node *root, *n;
+	int i;
+
+	zz_tree_init_flags(&tree, sizeof(struct zz_node), ZZ_TREE_STRING_POOL);
+	zz_tree_stats(&tree, &stats);
+	assert(stats.nodes == 0);
+	assert(stats.allocated == 0);
+	assert(stats.strings.count == 0);
+
+	root = zz_node(&tree, TOK_FOO, zz_null);
+	n = zz_node(&tree, TOK_BAR, zz_null);
+	zz_append_child(root, n);
+	for (i = 0; i < 8; ++i)
+		zz_append_child(n, zz_node(&tree, TOK_BAR,
+					zz_tree_string(&tree, i % 2 ? "a" : "bc")));
+	zz_tree_stats(&tree, &stats);
+	assert(stats.nodes == 10);
+	assert(stats.peak_nodes == 10);
+	assert(stats.node_bytes == 10 * tree.node_size);
+	assert(stats.allocated >= stats.node_bytes + stats.strings.memory);
+	assert(stats.strings.count == 2);
+	assert(stats.strings.bytes == 3);
+	assert(stats.strings.hits == 6);
+	assert(stats.strings.misses == 2);
+	assert(stats.strings.max_depth >= 1);
+	assert(stats.strings.memory > stats.strings.bytes);
+
+	zz_destroy(n);
+	zz_tree_stats(&tree, &stats);
+	assert(stats.nodes == 1);
+	assert(stats.peak_nodes == 10);
+	assert(stats.peak_node_bytes == 10 * tree.node_size);
+	zz_node(&tree, TOK_FOO, zz_null);
+	zz_tree_stats(&tree, &stats);
+	assert(stats.nodes == 2);
+	assert(stats.peak_nodes == 10);
+	zz_tree_destroy(&tree);
+}
+
+void shared_stats(void)
+{
+	struct zz_tree tree;
+	struct zz_tree_stats stats;
+	struct zz_node *leaves[10], *narrow, *wide;
+	size_t leaf_bytes, narrow_bytes, wide_bytes, allocated;
+	int i;
+
+	zz_tree_init_flags(&tree, sizeof(struct zz_shared_node), ZZ_TREE_SHARED);
+	for (i = 0; i < 10; ++i)
+		leaves[i] = zz_node(&tree, TOK_BAR, zz_int(i));
+	narrow = zz_node_shared(&tree, TOK_FOO, zz_null, leaves, 2);
+	wide = zz_node_shared(&tree, TOK_FOO, zz_null, leaves, 10);
+	leaf_bytes = tree.node_size;
+	narrow_bytes = tree.node_size + 2 * sizeof(struct zz_node *);
+	wide_bytes = tree.node_size + 10 * sizeof(struct zz_node *);
+	zz_tree_stats(&tree, &stats);
+	assert(stats.nodes == 12);
+	assert(stats.node_bytes == 10 * leaf_bytes + narrow_bytes + wide_bytes);
+	assert(stats.allocated >= stats.node_bytes +
+			tree.shared_size * sizeof(*tree.shared));
+	allocated = stats.allocated;
+
+	/* The wide node goes back to the allocator */
+	zz_unref(wide);
+	zz_tree_stats(&tree, &stats);
+	assert(stats.nodes == 11);
+	assert(stats.node_bytes == 10 * leaf_bytes + narrow_bytes);
+	assert(stats.peak_node_bytes == stats.node_bytes + wide_bytes);
+	assert(stats.allocated == allocated - wide_bytes);
+	zz_unref(narrow);
+	for (i = 0; i < 10; ++i)
+		zz_unref(leaves[i]);
+	zz_tree_destroy(&tree);
+}
+
+void strings_stats(void)
+{
+	struct zz_dict_stats before, stats;
+	struct zz_data d1, d2;
+
+	zz_strings_stats(&before);
+	d1 = zz_string("strings_stats");
+	d2 = zz_string("strings_stats");
+	zz_strings_stats(&stats);
+	assert(stats.count == before.count + 1);
+	assert(stats.bytes == before.bytes + strlen("strings_stats"));
+	assert(stats.hits == before.hits + 1);
+	assert(stats.misses == before.misses + 1);
+	assert(stats.max_depth >= 1);
+	zz_data_destroy(d1);
+	zz_data_destroy(d2);
+	zz_strings_stats(&stats);
+	assert(stats.count == before.count);
+	assert(stats.bytes == before.bytes);
+}
+
+int main(int argc, char *argv[])
+{
+	tree_stats();
+	shared_stats();
+	strings_stats();
+	exit(EXIT_SUCCESS);
+}
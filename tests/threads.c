@@ -0,0 +1,79 @@
+/*
+ * Stress test for the concurrent mode of the string dictionary
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+
+#define THREADS 8
+#define STRINGS 4096
+#define ROUNDS 16
+
+static const char *TOK_FOO = "foo";
+
+static const char *results[THREADS][STRINGS];
+static pthread_barrier_t barrier;
+
+/* Every thread builds its own tree with the same strings, keeps a copy of
+ * each of them, and destroys the tree, many times over */
+static void *build_trees(void *arg)
+{
+	const char **res = arg;
+	struct zz_tree tree;
+	struct zz_node *n;
+	struct zz_data copies[STRINGS], d;
+	char buf[16];
+	int i, j;
+
+	for (j = 0; j < ROUNDS; ++j) {
+		zz_tree_init(&tree, sizeof(struct zz_node));
+		for (i = 0; i < STRINGS; ++i) {
+			snprintf(buf, sizeof(buf), "%d", (i * 7 + j) % STRINGS);
+			n = zz_node(&tree, TOK_FOO, zz_string(buf));
+			assert(strcmp(zz_get_string(n), buf) == 0);
+			copies[i] = zz_data_copy(n->data);
+		}
+		zz_tree_destroy(&tree);
+		for (i = 0; i < STRINGS; ++i)
+			zz_data_destroy(copies[i]);
+	}
+	/* Finally intern all strings and compare them with other threads */
+	for (i = 0; i < STRINGS; ++i) {
+		snprintf(buf, sizeof(buf), "%d", i);
+		d = zz_string(buf);
+		res[i] = zz_data_string(&d);
+	}
+	pthread_barrier_wait(&barrier);
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	pthread_t threads[THREADS];
+	struct zz_data d;
+	int i, j;
+
+	zz_strings_set_concurrent(1);
+	pthread_barrier_init(&barrier, NULL, THREADS);
+	for (i = 0; i < THREADS; ++i)
+		pthread_create(&threads[i], NULL, build_trees, results[i]);
+	for (i = 0; i < THREADS; ++i)
+		pthread_join(threads[i], NULL);
+	pthread_barrier_destroy(&barrier);
+	for (i = 0; i < STRINGS; ++i) {
+		for (j = 1; j < THREADS; ++j)
+			assert(results[j][i] == results[0][i]);
+		for (j = 0; j < THREADS; ++j) {
+			d = zz_null;
+			d.type = ZZ_STRING;
+			d.data.string_val = results[j][i];
+			zz_data_destroy(d);
+		}
+	}
+	zz_strings_set_concurrent(0);
+	exit(EXIT_SUCCESS);
+}
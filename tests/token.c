@@ -0,0 +1,126 @@
+/*
+ * Test for the token registry
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+
+enum {
+	TOK_FUNC,
+	TOK_TYPE,
+	TOK_IDENT,
+	TOK_CALL,
+	TOK_COUNT
+};
+
+static const char *const NAMES[] = { "func", "type", "ident", "call" };
+
+static const char *tokens[TOK_COUNT];
+
+static void count(struct zz_node *n, size_t *counts)
+{
+	struct zz_node *i;
+
+	++counts[zz_get_token_id(n)];
+	zz_foreach_child(i, n)
+		count(i, counts);
+}
+
+static const char *describe(struct zz_node *n)
+{
+	switch (zz_get_token_id(n)) {
+	case TOK_FUNC:
+		return "function";
+	case TOK_TYPE:
+		return "type";
+	case TOK_IDENT:
+		return "identifier";
+	case TOK_CALL:
+		return "call";
+	default:
+		return "unknown";
+	}
+}
+
+void registry(void)
+{
+	struct zz_tokens t;
+	struct zz_tree tree;
+	struct zz_node *root, *n;
+	size_t counts[TOK_COUNT + 1] = { 0 };
+	const char *extra;
+	size_t i;
+
+	zz_tokens_init(&t);
+	for (i = 0; i < TOK_COUNT; ++i) {
+		tokens[i] = zz_tokens_add(&t, NAMES[i]);
+		assert(zz_token_id(tokens[i]) == i);
+		assert(zz_token_length(tokens[i]) == strlen(NAMES[i]));
+	}
+	assert(zz_tokens_count(&t) == TOK_COUNT);
+
+	/* Adding again returns the same token */
+	assert(zz_tokens_add(&t, "ident") == tokens[TOK_IDENT]);
+	assert(zz_tokens_lookup(&t, "call") == tokens[TOK_CALL]);
+	assert(zz_tokens_lookup(&t, "body") == NULL);
+	extra = zz_tokens_add(&t, "body");
+	assert(zz_token_id(extra) == TOK_COUNT);
+	assert(zz_tokens_count(&t) == TOK_COUNT + 1);
+	assert(strcmp(zz_tokens_name(&t, TOK_TYPE), "type") == 0);
+	assert(zz_tokens_name(&t, TOK_COUNT + 1) == NULL);
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	root = zz_node(&tree, tokens[TOK_FUNC], zz_null);
+	zz_append_child(root, zz_node(&tree, tokens[TOK_TYPE], zz_string("int")));
+	zz_append_child(root, zz_node(&tree, tokens[TOK_IDENT], zz_string("main")));
+	n = zz_node(&tree, extra, zz_null);
+	zz_append_child(root, n);
+	zz_append_child(n, zz_node(&tree, tokens[TOK_CALL], zz_null));
+	zz_append_child(zz_first_child(n),
+			zz_node(&tree, tokens[TOK_IDENT], zz_string("puts")));
+	zz_print(root, stdout);
+	printf("\n");
+
+	count(root, counts);
+	for (i = 0; i < zz_tokens_count(&t); ++i)
+		printf("%s %zu\n", zz_tokens_name(&t, i), counts[i]);
+	zz_foreach_child(n, root)
+		printf("%s\n", describe(n));
+
+	zz_tree_destroy(&tree);
+	zz_tokens_destroy(&t);
+}
+
+/* Many tokens, so that the table of names grows several times */
+void many(void)
+{
+	struct zz_tokens t;
+	const char *added[1000];
+	char buf[16];
+	size_t i;
+
+	zz_tokens_init(&t);
+	for (i = 0; i < 1000; ++i) {
+		snprintf(buf, sizeof(buf), "t%zu", i);
+		added[i] = zz_tokens_add(&t, buf);
+		assert(zz_token_id(added[i]) == i);
+	}
+	for (i = 0; i < 1000; ++i) {
+		snprintf(buf, sizeof(buf), "t%zu", i);
+		assert(zz_tokens_lookup(&t, buf) == added[i]);
+		assert(zz_tokens_add(&t, buf) == added[i]);
+	}
+	assert(zz_tokens_count(&t) == 1000);
+	assert(zz_tokens_lookup(&t, "t1000") == NULL);
+	assert(zz_tokens_lookup(&t, "t") == NULL);
+	zz_tokens_destroy(&t);
+}
+
+int main(int argc, char *argv[])
+{
+	registry();
+	many();
+	exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,185 @@
+/*
+ * Test for persistent versions of shared trees
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "../src/zebu.h"
+
+static const char *TOK_FUNC = "func";
+static const char *TOK_TYPE = "type";
+static const char *TOK_IDENT = "ident";
+static const char *TOK_ARG = "arg";
+static const char *TOK_POINTER = "pointer";
+static const char *TOK_ARGLIST = "arglist";
+static const char *TOK_NUM = "num";
+
+/* Same function as tests/build.c, in a tree that doesn't share nodes */
+static struct zz_node *build(struct zz_tree *tree)
+{
+	struct zz_node *func, *args, *arg, *p;
+
+	func = zz_node(tree, TOK_FUNC, zz_null);
+	zz_append_child(func, zz_node(tree, TOK_TYPE, zz_string("int")));
+	zz_append_child(func, zz_node(tree, TOK_IDENT, zz_string("main")));
+	args = zz_node(tree, TOK_ARGLIST, zz_null);
+	zz_append_child(func, args);
+	arg = zz_node(tree, TOK_ARG, zz_null);
+	zz_append_child(args, arg);
+	zz_append_child(arg, zz_node(tree, TOK_TYPE, zz_string("int")));
+	zz_append_child(arg, zz_node(tree, TOK_IDENT, zz_string("argc")));
+	arg = zz_node(tree, TOK_ARG, zz_null);
+	zz_append_child(args, arg);
+	p = zz_node(tree, TOK_POINTER, zz_null);
+	zz_append_child(arg, p);
+	zz_append_child(p, zz_node(tree, TOK_POINTER, zz_null));
+	zz_append_child(zz_first_child(p),
+			zz_node(tree, TOK_TYPE, zz_string("int")));
+	zz_append_child(arg, zz_node(tree, TOK_IDENT, zz_string("argv")));
+	return func;
+}
+
+static void print(const char *name, struct zz_node *n)
+{
+	printf("%s ", name);
+	zz_print(n, stdout);
+	printf(" (%zu nodes)\n", n->tree->node_count);
+}
+
+void versions(void)
+{
+	struct zz_tree tree, shared;
+	struct zz_node *v1, *v2, *v3, *v4, *n;
+	static const size_t argv_path[] = { 2, 1, 1, 0 };
+	static const size_t args_path[] = { 2 };
+
+	zz_tree_init(&tree, sizeof(struct zz_node));
+	zz_tree_init_flags(&shared, sizeof(struct zz_shared_node), ZZ_TREE_SHARED);
+	v1 = zz_copy_recursive(&shared, build(&tree));
+	print("v1", v1);
+
+	/* Only the path to the changed node is new */
+	v2 = zz_version_set_data(v1, argv_path, 3, zz_string("args"));
+	print("v1", v1);
+	print("v2", v2);
+	assert(zz_version_node(v1, argv_path, 3)->data.data.string_val !=
+			zz_version_node(v2, argv_path, 3)->data.data.string_val);
+	assert(zz_child(v1, 0) == zz_child(v2, 0));
+	assert(zz_child(v1, 1) == zz_child(v2, 1));
+	assert(zz_child(zz_child(v1, 2), 0) == zz_child(zz_child(v2, 2), 0));
+	assert(zz_child(zz_child(zz_child(v1, 2), 1), 0) ==
+			zz_child(zz_child(zz_child(v2, 2), 1), 0));
+	assert(zz_version_node(v1, argv_path, 4) == NULL);
+
+	/* Inserting and removing the same child gives back an equal tree,
+	 * which is the same node */
+	n = zz_node(&shared, TOK_ARG, zz_null);
+	v3 = zz_version_insert(v2, args_path, 1, 0, n);
+	zz_unref(n);
+	print("v3", v3);
+	assert(zz_child_count(zz_child(v3, 2)) == 3);
+	v4 = zz_version_remove(v3, args_path, 1, 0);
+	assert(v4 == v2);
+	zz_version_release(v4);
+
+	/* Putting back the old subtree gives back the old version */
+	v4 = zz_version_replace(v2, args_path, 1, zz_child(v1, 2));
+	assert(v4 == v1);
+	n = zz_version_replace(v3, NULL, 0, zz_child(v3, 2));
+	print("n", n);
+
+	/* Versions are released in any order */
+	zz_version_release(v2);
+	print("v1", v1);
+	zz_version_release(v1);
+	print("v3", v3);
+	zz_version_release(v3);
+	print("v4", v4);
+	zz_version_release(v4);
+	print("n", n);
+	zz_version_release(n);
+	assert(shared.node_count == 0);
+
+	/* Released nodes are no longer found */
+	n = zz_node(&shared, TOK_TYPE, zz_string("int"));
+	assert(shared.node_count == 1);
+	zz_tree_destroy(&shared);
+	zz_tree_destroy(&tree);
+}
+
+void wide(void)
+{
+	struct zz_tree tree;
+	struct zz_tree_stats stats;
+	struct zz_node **children, *v, *next;
+	size_t path[2], allocated, i;
+
+	/* Wide nodes, and nodes of the same size, are reused as versions are
+	 * released */
+	zz_tree_init_flags(&tree, sizeof(struct zz_shared_node), ZZ_TREE_SHARED);
+	children = malloc(1000 * sizeof(*children));
+	for (i = 0; i < 1000; ++i)
+		children[i] = zz_node_shared(&tree, TOK_ARGLIST, zz_null,
+				children, i < 5 ? i : 5);
+	v = zz_node_shared(&tree, TOK_FUNC, zz_null, children, 1000);
+	for (i = 0; i < 1000; ++i)
+		zz_unref(children[i]);
+	free(children);
+	printf("wide nodes %zu\n", tree.node_count);
+	path[0] = 999;
+	path[1] = 4;
+	for (i = 0; i < 10000; ++i) {
+		next = zz_version_set_data(v, path, 2, zz_int(i % 100));
+		zz_version_release(v);
+		v = next;
+		assert(zz_version_node(v, path, 2)->data.data.int_val ==
+				i % 100);
+		if (i == 0) {
+			zz_tree_stats(&tree, &stats);
+			allocated = stats.allocated;
+		}
+	}
+	zz_tree_stats(&tree, &stats);
+	assert(stats.allocated == allocated);
+	printf("wide nodes %zu\n", tree.node_count);
+	zz_version_release(v);
+	printf("wide nodes %zu\n", tree.node_count);
+	zz_tree_destroy(&tree);
+}
+
+void deep(void)
+{
+	struct zz_tree tree;
+	struct zz_node *n, *p, *v;
+	size_t *path;
+	int i;
+
+	/* Deep versions don't need a deep call stack */
+	zz_tree_init_flags(&tree, sizeof(struct zz_shared_node), ZZ_TREE_SHARED);
+	n = zz_node(&tree, TOK_NUM, zz_int(0));
+	for (i = 1; i < 100000; ++i) {
+		p = zz_node_shared(&tree, TOK_NUM, zz_int(i), &n, 1);
+		zz_unref(n);
+		n = p;
+	}
+	v = n;
+	path = calloc(99999, sizeof(*path));
+	n = zz_version_set_data(v, path, 99999, zz_int(-1));
+	assert(tree.node_count == 200000);
+	zz_version_release(v);
+	assert(tree.node_count == 100000);
+	assert(zz_version_node(n, path, 99999)->data.data.int_val == -1);
+	zz_version_release(n);
+	assert(tree.node_count == 0);
+	free(path);
+	zz_tree_destroy(&tree);
+}
+
+int main(int argc, char *argv[])
+{
+	versions();
+	wide();
+	deep();
+	exit(EXIT_SUCCESS);
+}
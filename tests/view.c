@@ -0,0 +1,187 @@
+/*
+ * Test for memory-mapped views of saved trees
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../src/zebu.h"
+
+struct node_with_location {
+	struct zz_node node;
+	int location;
+};
+
+static const char *TOK_FOO = "foo";
+static const char *TOK_BAR = "bar";
+static const char *TOK_BAZ = "baz";
+
+static void print(const struct zz_view *v, size_t n)
+{
+	size_t i;
+
+	printf("[%s", zz_view_token(v, n));
+	switch (zz_view_type(v, n)) {
+	case ZZ_INT:
+		printf(" %d", zz_view_int(v, n));
+		break;
+	case ZZ_UINT:
+		printf(" %u", zz_view_uint(v, n));
+		break;
+	case ZZ_DOUBLE:
+		printf(" %f", zz_view_double(v, n));
+		break;
+	case ZZ_STRING:
+		printf(" \"%s\"", zz_view_string(v, n));
+		break;
+	default:
+		break;
+	}
+	zz_view_foreach_child(i, v, n) {
+		printf(" ");
+		print(v, i);
+	}
+	printf("]");
+}
+
+/* Overwrite the 64-bit word at ``offset`` in the file, and return the one
+ * that was there */
+static uint64_t patch(const char *path, uint64_t offset, uint64_t value)
+{
+	uint64_t old;
+	FILE *f;
+
+	f = fopen(path, "r+");
+	assert(f != NULL);
+	fseek(f, offset, SEEK_SET);
+	assert(fread(&old, sizeof(old), 1, f) == 1);
+	fseek(f, offset, SEEK_SET);
+	fwrite(&value, sizeof(value), 1, f);
+	fclose(f);
+	return old;
+}
+
+/* Number of nodes whose token, or string if they have one, can't be read */
+static size_t unreadable(const char *path)
+{
+	struct zz_view v;
+	size_t i, count = 0;
+
+	assert(zz_view_open(&v, path) == 0);
+	for (i = 0; i < zz_view_count(&v); ++i) {
+		if (zz_view_token(&v, i) == NULL ||
+				(zz_view_type(&v, i) == ZZ_STRING &&
+				 zz_view_string(&v, i) == NULL))
+			++count;
+	}
+	zz_view_close(&v);
+	return count;
+}
+
+/* Table entries that point outside the file, or to strings without their
+ * NUL, read as NULL; opening the view doesn't look at them */
+static void corrupt_tables(const char *path)
+{
+	struct zz_file_header h;
+	uint64_t entry, old;
+	FILE *f;
+
+	f = fopen(path, "r");
+	assert(fread(&h, sizeof(h), 1, f) == 1);
+	fclose(f);
+
+	assert(unreadable(path) == 0);
+	entry = h.strings_offset + offsetof(struct zz_file_string, offset);
+	old = patch(path, entry, h.file_size + 100);
+	assert(unreadable(path) == 1);
+	patch(path, entry, old);
+	entry = h.strings_offset + offsetof(struct zz_file_string, length);
+	old = patch(path, entry, 0);
+	assert(unreadable(path) == 1);
+	patch(path, entry, old + 1);
+	assert(unreadable(path) == 1);
+	patch(path, entry, UINT64_MAX);
+	assert(unreadable(path) == 1);
+	patch(path, entry, old);
+	entry = h.tokens_offset + offsetof(struct zz_file_string, length);
+	old = patch(path, entry, 0);
+	assert(unreadable(path) > 0);
+	patch(path, entry, old);
+	assert(unreadable(path) == 0);
+}
+
+void open_and_walk(void)
+{
+	struct zz_tree tree;
+	struct zz_view v;
+	struct zz_node *root, *n;
+	char path[] = "/tmp/zebu-view-XXXXXX";
+	FILE *f;
+	size_t i;
+	int fd, loc;
+
+	zz_tree_init(&tree, sizeof(struct node_with_location));
+	root = zz_node(&tree, TOK_FOO, zz_null);
+	zz_append_child(root, zz_node(&tree, TOK_BAR, zz_int(-314)));
+	n = zz_node(&tree, TOK_BAZ, zz_double(0.5));
+	zz_append_child(root, n);
+	zz_append_child(n, zz_node(&tree, TOK_BAR, zz_string("314")));
+	zz_append_child(n, zz_node(&tree, TOK_FOO, zz_uint(314)));
+	zz_append_child(root, zz_node(&tree, TOK_BAZ, zz_string_n("a\0b", 3)));
+	loc = 0;
+	zz_foreach_child(n, root)
+		((struct node_with_location *)n)->location = ++loc;
+
+	fd = mkstemp(path);
+	assert(fd >= 0);
+	f = fdopen(fd, "w");
+	assert(zz_tree_save(root, f) == 0);
+	fclose(f);
+
+	assert(zz_view_open(&v, path) == 0);
+	assert(zz_view_count(&v) == 6);
+	print(&v, zz_view_root(&v));
+	printf("\n");
+
+	assert(zz_view_child_count(&v, 0) == 3);
+	i = zz_view_first_child(&v, 0);
+	loc = 0;
+	zz_foreach_child(n, root) {
+		assert(strcmp(zz_view_token(&v, i), n->token) == 0);
+		assert(zz_view_type(&v, i) == n->data.type);
+		assert(*(const int *)zz_view_ext(&v, i) ==
+				((struct node_with_location *)n)->location);
+		i = zz_view_next_sibling(&v, i);
+	}
+	assert(i == 0);
+	i = zz_view_first_child(&v, zz_view_first_child(&v, 0));
+	assert(i == 0);
+	i = zz_view_next_sibling(&v, zz_view_first_child(&v, 0));
+	i = zz_view_next_sibling(&v, i);
+	assert(zz_view_string_length(&v, i) == 3);
+	assert(memcmp(zz_view_string(&v, i), "a\0b", 4) == 0);
+	zz_view_close(&v);
+	corrupt_tables(path);
+
+	/* Not a tree */
+	f = fopen(path, "r+");
+	fputs("ZEBV", f);
+	fclose(f);
+	assert(zz_view_open(&v, path) < 0);
+
+	/* Truncated file */
+	truncate(path, 32);
+	assert(zz_view_open(&v, path) < 0);
+
+	unlink(path);
+	assert(zz_view_open(&v, path) < 0);
+	zz_tree_destroy(&tree);
+}
+
+int main(int argc, char *argv[])
+{
+	open_and_walk();
+	exit(EXIT_SUCCESS);
+}